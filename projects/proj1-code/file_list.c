@@ -36,6 +36,23 @@ int file_list_add(file_list_t *list, const char *file_name) {
     return 0;
 }
 
+int file_list_append(file_list_t *list, node_t **tail, const char *file_name) {
+    node_t *node = malloc(sizeof(node_t));
+    if (node == NULL) {
+        return 1;
+    }
+    strncpy(node->name, file_name, MAX_NAME_LEN);
+    node->next = NULL;
+    if (list->head == NULL) {
+        list->head = node;
+    } else {
+        (*tail)->next = node;
+    }
+    *tail = node;
+    list->size++;
+    return 0;
+}
+
 int file_list_contains(const file_list_t *list, const char *file_name) {
     node_t *current = list->head;
     while (current != NULL) {
@@ -24,6 +24,12 @@ void file_list_init(file_list_t *list);
 // Returns 0 on success or 1 if an error occurs
 int file_list_add(file_list_t *list, const char *file_name);
 
+// Add a new file name to the tail of the linked list, whose last node is '*tail'
+// (ignored while the list is empty), then update '*tail'. Unlike file_list_add,
+// this doesn't walk the list, so building a long list stays linear
+// Returns 0 on success or 1 if an error occurs
+int file_list_append(file_list_t *list, node_t **tail, const char *file_name);
+
 // Remove all entries from the list and free any memory associated with them
 void file_list_clear(file_list_t *list);
 
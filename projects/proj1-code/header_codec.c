@@ -0,0 +1,177 @@
+#include "header_codec.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Value of each octal digit character plus one, so that 0 marks every byte
+ * that isn't an octal digit.
+ */
+static const unsigned char octal_digit_values[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8,
+};
+
+/*
+ * Every pair of octal digits, indexed by the 6-bit value they represent, so
+ * encoding emits two digits per step.
+ */
+static const char octal_digit_pairs[64][2] = {
+    "00", "01", "02", "03", "04", "05", "06", "07", "10", "11", "12", "13", "14", "15", "16",
+    "17", "20", "21", "22", "23", "24", "25", "26", "27", "30", "31", "32", "33", "34", "35",
+    "36", "37", "40", "41", "42", "43", "44", "45", "46", "47", "50", "51", "52", "53", "54",
+    "55", "56", "57", "60", "61", "62", "63", "64", "65", "66", "67", "70", "71", "72", "73",
+    "74", "75", "76", "77",
+};
+
+int encode_numeric_field(char *field, int width, unsigned long long value) {
+    int digits = width - 1;
+
+    // Too big for octal: fall back to base-256, big-endian after the marker byte
+    if (digits * 3 < 64 && (value >> (digits * 3)) != 0) {
+        if (digits * 8 < 64 && (value >> (digits * 8)) != 0) {
+            return -1;
+        }
+        field[0] = (char) 0x80;
+        for (int i = width - 1; i > 0; i--) {
+            field[i] = (char) (value & 0xff);
+            value >>= 8;
+        }
+        return 0;
+    }
+
+    field[digits] = '\0';
+    int i = digits;
+    while (i >= 2) {
+        memcpy(&field[i - 2], octal_digit_pairs[value & 077], 2);
+        value >>= 6;
+        i -= 2;
+    }
+    if (i == 1) {
+        field[0] = (char) ('0' + (value & 07));
+    }
+    return 0;
+}
+
+int decode_numeric_field(const char *field, int width, unsigned long long *value) {
+    const unsigned char *bytes = (const unsigned char *) field;
+
+    // GNU base-256: only non-negative values are meaningful in this project
+    if (bytes[0] & 0x80) {
+        if (bytes[0] != 0x80) {
+            return -1;
+        }
+        unsigned long long result = 0;
+        for (int i = 1; i < width; i++) {
+            if (result >> 56) {
+                return -1;
+            }
+            result = (result << 8) | bytes[i];
+        }
+        *value = result;
+        return 0;
+    }
+
+    int i = 0;
+    while (i < width && bytes[i] == ' ') {
+        i++;
+    }
+    if (i == width || octal_digit_values[bytes[i]] == 0) {
+        return -1;    // No digits at all
+    }
+
+    unsigned long long result = 0;
+    for (; i < width && octal_digit_values[bytes[i]] != 0; i++) {
+        if (result >> 61) {
+            return -1;
+        }
+        result = (result << 3) | (octal_digit_values[bytes[i]] - 1);
+    }
+    if (i < width && bytes[i] != '\0' && bytes[i] != ' ') {
+        return -1;    // Trailing garbage
+    }
+    *value = result;
+    return 0;
+}
+
+/*
+ * Sums the bytes of 'header', with the checksum field itself counted as blanks.
+ * Writers have historically disagreed on whether header bytes are signed, so
+ * both sums are produced from a single pass: the signed sum is the unsigned one
+ * minus 256 for every byte with its high bit set.
+ * The header is processed 8 bytes at a time, with the byte sums accumulated in
+ * 16-bit lanes and the high-bit counts in 8-bit lanes of a 64-bit word; neither
+ * can overflow over the 64 words of a header.
+ */
+static void sum_header_bytes(const tar_header *header, unsigned long long *unsigned_sum,
+                             long long *signed_sum) {
+    const unsigned char *bytes = (const unsigned char *) header;
+    uint64_t lane_sums = 0;
+    uint64_t lane_high_bytes = 0;
+    for (size_t i = 0; i < sizeof(tar_header); i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        lane_sums += (word & 0x00ff00ff00ff00ffULL) + ((word >> 8) & 0x00ff00ff00ff00ffULL);
+        lane_high_bytes += (word >> 7) & 0x0101010101010101ULL;
+    }
+    // Add up the lanes
+    unsigned long long sum = 0;
+    unsigned long long high_bytes = 0;
+    for (int shift = 0; shift < 64; shift += 16) {
+        sum += (lane_sums >> shift) & 0xffff;
+    }
+    for (int shift = 0; shift < 64; shift += 8) {
+        high_bytes += (lane_high_bytes >> shift) & 0xff;
+    }
+
+    // Swap the checksum field's current contents for blanks
+    const unsigned char *chksum = (const unsigned char *) header->chksum;
+    for (size_t i = 0; i < sizeof(header->chksum); i++) {
+        sum += ' ' - chksum[i];
+        high_bytes -= chksum[i] >> 7;
+    }
+
+    *unsigned_sum = sum;
+    *signed_sum = (long long) sum - 256 * (long long) high_bytes;
+}
+
+int encode_checksum(tar_header *header) {
+    unsigned long long unsigned_sum;
+    long long signed_sum;
+    sum_header_bytes(header, &unsigned_sum, &signed_sum);
+    // POSIX specifies the unsigned sum, which at most 512 * 255 always fits in 7 octal digits
+    return ENCODE_FIELD(header->chksum, unsigned_sum);
+}
+
+int decode_tar_header(const tar_header *header, decoded_header_t *decoded) {
+    unsigned long long chksum;
+    unsigned long long unsigned_sum;
+    long long signed_sum;
+    sum_header_bytes(header, &unsigned_sum, &signed_sum);
+    if (DECODE_FIELD(header->chksum, &chksum) != 0 ||
+        (chksum != unsigned_sum && chksum != (unsigned) signed_sum)) {
+        return -1;
+    }
+
+    if (DECODE_FIELD(header->mode, &decoded->mode) != 0 ||
+        DECODE_FIELD(header->uid, &decoded->uid) != 0 ||
+        DECODE_FIELD(header->gid, &decoded->gid) != 0 ||
+        DECODE_FIELD(header->size, &decoded->size) != 0 ||
+        DECODE_FIELD(header->mtime, &decoded->mtime) != 0) {
+        return -1;
+    }
+    decoded->typeflag = header->typeflag;
+
+    // Neither field has to be null-terminated when it's completely full
+    int name_len = strnlen(header->name, sizeof(header->name));
+    int prefix_len = strnlen(header->prefix, sizeof(header->prefix));
+    char *out = decoded->name;
+    if (prefix_len > 0) {
+        memcpy(out, header->prefix, prefix_len);
+        out += prefix_len;
+        *out++ = '/';
+    }
+    memcpy(out, header->name, name_len);
+    out[name_len] = '\0';
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef _HEADER_CODEC_H
+#define _HEADER_CODEC_H
+#include "minitar.h"
+
+// Room for the longest member name a header can hold: prefix, '/', name, null terminator
+#define MAX_MEMBER_NAME_LEN (155 + 1 + 100 + 1)
+
+// A tar header with every field parsed, shared by all code that reads archives
+typedef struct {
+    // File's name (prefix and name joined), as a null-terminated string
+    char name[MAX_MEMBER_NAME_LEN];
+    unsigned long long mode;
+    unsigned long long uid;
+    unsigned long long gid;
+    // Size of file in bytes
+    unsigned long long size;
+    // Modification time of file in Unix epoch time
+    unsigned long long mtime;
+    char typeflag;
+} decoded_header_t;
+
+/*
+ * Store 'value' in the numeric header field 'field' of 'width' bytes: as
+ * 'width' - 1 zero-padded octal digits and a null terminator when it fits,
+ * otherwise in the GNU base-256 format (marked by the high bit of the first byte).
+ * No formatted I/O is involved, and nothing is allocated.
+ * Returns 0 on success or -1 if 'value' can't be represented in 'width' bytes.
+ */
+int encode_numeric_field(char *field, int width, unsigned long long value);
+
+/*
+ * Parse the numeric header field 'field' of 'width' bytes into 'value'.
+ * Accepts leading spaces, then octal digits terminated by a space, a null byte
+ * or the end of the field, or else a GNU base-256 number.
+ * Returns 0 on success or -1 if the field is malformed or its value overflows.
+ */
+int decode_numeric_field(const char *field, int width, unsigned long long *value);
+
+// Convenience wrappers that take the field width from the header struct itself
+#define ENCODE_FIELD(field, value) encode_numeric_field((field), sizeof(field), (value))
+#define DECODE_FIELD(field, value) decode_numeric_field((field), sizeof(field), (value))
+
+/*
+ * Compute the checksum of 'header' and store it in its 'chksum' field.
+ * Performs a simple unsigned sum over all bytes in the header in accordance
+ * with POSIX standard for tar file structure.
+ * Returns 0 on success or -1 if the sum doesn't fit in the field, which can't
+ * happen for a well-formed header.
+ */
+int encode_checksum(tar_header *header);
+
+/*
+ * Validate 'header' and parse it into 'decoded'. Fails if any numeric field is
+ * malformed or the checksum doesn't match the header's contents.
+ * Returns 0 on success or -1 if the header is invalid.
+ */
+int decode_tar_header(const tar_header *header, decoded_header_t *decoded);
+
+#endif    // _HEADER_CODEC_H
@@ -0,0 +1,136 @@
+#include "layout.h"
+
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_MSG_LEN 128
+
+// Sort key describing where a file lives on disk
+typedef struct {
+    dev_t dev;
+    int unmapped;                 // 0 if 'location' is a physical offset, 1 if it's an inode number
+    unsigned long long location;
+    int index;                    // Position of the file in the input list
+} layout_key_t;
+
+static int compare_layout_keys(const void *a, const void *b) {
+    const layout_key_t *k1 = a;
+    const layout_key_t *k2 = b;
+    if (k1->dev != k2->dev) {
+        return k1->dev < k2->dev ? -1 : 1;
+    }
+    if (k1->unmapped != k2->unmapped) {
+        return k1->unmapped - k2->unmapped;
+    }
+    if (k1->location != k2->location) {
+        return k1->location < k2->location ? -1 : 1;
+    }
+    return k1->index - k2->index;
+}
+
+/*
+ * Looks up the physical byte offset of the first extent of 'file_name'.
+ * Returns 0 upon success, -1 if the location is unavailable
+ */
+static int first_extent_offset(const char *file_name, unsigned long long *offset) {
+    int fd = open(file_name, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+
+    // Room for the request header plus a single extent
+    struct {
+        struct fiemap map;
+        struct fiemap_extent extent;
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.map.fm_start = 0;
+    request.map.fm_length = FIEMAP_MAX_OFFSET;
+    request.map.fm_extent_count = 1;
+
+    int ret = ioctl(fd, FS_IOC_FIEMAP, &request.map);
+    close(fd);
+    if (ret != 0 || request.map.fm_mapped_extents == 0 ||
+        (request.extent.fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE))) {
+        return -1;
+    }
+    *offset = request.extent.fe_physical;
+    return 0;
+}
+
+int parse_read_order(const char *spec) {
+    if (strcmp(spec, "inode") == 0) {
+        return READ_ORDER_INODE;
+    }
+    if (strcmp(spec, "extent") == 0) {
+        return READ_ORDER_EXTENT;
+    }
+    return -1;
+}
+
+int compute_read_order(const file_list_t *files, int mode, int *read_order) {
+    layout_key_t *keys = malloc((files->size + 1) * sizeof(layout_key_t));
+    if (keys == NULL) {
+        perror("Failed to allocate read order");
+        return -1;
+    }
+
+    int index = 0;
+    for (node_t *cur = files->head; cur != NULL; cur = cur->next, index++) {
+        layout_key_t *key = &keys[index];
+        key->index = index;
+        key->unmapped = 1;
+
+        struct stat stat_buf;
+        if (stat(cur->name, &stat_buf) != 0) {
+            char err_msg[MAX_MSG_LEN];
+            snprintf(err_msg, MAX_MSG_LEN, "Failed to stat file %s", cur->name);
+            perror(err_msg);
+            free(keys);
+            return -1;
+        }
+        key->dev = stat_buf.st_dev;
+        key->location = stat_buf.st_ino;
+        if (mode == READ_ORDER_EXTENT && first_extent_offset(cur->name, &key->location) == 0) {
+            key->unmapped = 0;
+        }
+    }
+
+    if (mode != READ_ORDER_NONE) {
+        qsort(keys, files->size, sizeof(layout_key_t), compare_layout_keys);
+    }
+    for (int i = 0; i < files->size; i++) {
+        read_order[i] = keys[i].index;
+    }
+    free(keys);
+    return 0;
+}
+
+int reorder_file_list(file_list_t *files, const int *read_order) {
+    node_t **nodes = malloc((files->size + 1) * sizeof(node_t *));
+    if (nodes == NULL) {
+        perror("Failed to allocate read order");
+        return -1;
+    }
+    int index = 0;
+    for (node_t *cur = files->head; cur != NULL; cur = cur->next) {
+        nodes[index++] = cur;
+    }
+
+    // Relink the existing nodes rather than copying names into a new list
+    for (int i = 0; i < files->size; i++) {
+        nodes[read_order[i]]->next = (i + 1 < files->size) ? nodes[read_order[i + 1]] : NULL;
+    }
+    if (files->size > 0) {
+        files->head = nodes[read_order[0]];
+    }
+    free(nodes);
+    return 0;
+}
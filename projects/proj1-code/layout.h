@@ -0,0 +1,32 @@
+#ifndef _LAYOUT_H
+#define _LAYOUT_H
+#include "file_list.h"
+
+// Orders in which create can read its input files
+#define READ_ORDER_NONE 0      // Command-line order
+#define READ_ORDER_INODE 1     // By inode number, which roughly tracks on-disk placement
+#define READ_ORDER_EXTENT 2    // By physical location of each file's first extent, via FIEMAP
+
+/*
+ * Parse a read order name from the command line ("inode" or "extent").
+ * Returns one of the READ_ORDER_* constants, or -1 if 'spec' is not recognized.
+ */
+int parse_read_order(const char *spec);
+
+/*
+ * Fill 'read_order' with the positions of the elements of 'files', sorted so
+ * that reading the files in that order is as close to sequential on disk as
+ * possible. 'read_order' must have room for 'files->size' elements.
+ * With READ_ORDER_EXTENT, files whose extents can't be mapped (unsupported
+ * filesystem, empty or inline files) are read after the mapped ones, by inode.
+ * This function should return 0 upon success or -1 if an error occurred.
+ */
+int compute_read_order(const file_list_t *files, int mode, int *read_order);
+
+/*
+ * Rearrange the elements of 'files' into the order given by 'read_order'.
+ * This function should return 0 upon success or -1 if an error occurred.
+ */
+int reorder_file_list(file_list_t *files, const int *read_order);
+
+#endif    // _LAYOUT_H
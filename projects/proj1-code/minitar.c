@@ -1,21 +1,37 @@
 /*partners worked on this project: Abdirahman Hassan (hassa878) and Youssef Abdulle (abdul664)*/
 
+#define _GNU_SOURCE    // For fallocate and sync_file_range
+
 #include "minitar.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <grp.h>
 #include <math.h>
 #include <pwd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "header_codec.h"
+
 #define NUM_TRAILING_BLOCKS 2
 #define MAX_MSG_LEN 128
 #define BLOCK_SIZE 512
+#define PWGR_BUF_LEN 4096
+// With IO_DROP_CACHE, file pages are released each time this many bytes have been consumed
+#define IO_DROP_WINDOW (8 * 1024 * 1024)
+// Most extracted files waiting at once for their pages to be released
+#define IO_QUEUE_LEN 64
+// Most member data held in memory at once by create_archive_in_read_order
+#define REORDER_BUFFER_SIZE (64 * 1024 * 1024)
+// Amount of archive data compared at a time when diffing against the file system
+#define DIFF_CHUNK_SIZE (64 * 1024)
 
 // Constants for tar compatibility information
 #define MAGIC "ustar"
@@ -24,21 +40,182 @@
 // We'll only use regular files in this project
 #define REGTYPE '0'
 #define DIRTYPE '5'
+// pax global extended header, which deletion markers are stored as
+#define XGLTYPE 'g'
+// Vendor keyword of a global header record naming a file deleted since the previous
+// incremental archive
+#define DELETED_KEYWORD "MINITAR.deleted"
+
+// Active I/O policy, a combination of the IO_* flags in minitar.h
+static int io_policy = IO_POLICY_DEFAULT;
+
+void set_io_policy(int flags) {
+    io_policy = flags;
+}
+
+int parse_io_policy(const char *spec, int *flags) {
+    if (strcmp(spec, "none") == 0) {
+        *flags = 0;
+        return 0;
+    }
+    if (strcmp(spec, "default") == 0) {
+        *flags = IO_POLICY_DEFAULT;
+        return 0;
+    }
+    if (strcmp(spec, "bulk") == 0) {
+        *flags = IO_ADVISE_SEQUENTIAL | IO_DROP_CACHE | IO_PREALLOCATE;
+        return 0;
+    }
+
+    // Otherwise a comma-separated list of individual settings
+    int parsed = 0;
+    const char *cur = spec;
+    while (*cur != '\0') {
+        size_t len = strcspn(cur, ",");
+        if (len == 3 && strncmp(cur, "seq", len) == 0) {
+            parsed |= IO_ADVISE_SEQUENTIAL;
+        } else if (len == 4 && strncmp(cur, "drop", len) == 0) {
+            parsed |= IO_DROP_CACHE;
+        } else if (len == 8 && strncmp(cur, "prealloc", len) == 0) {
+            parsed |= IO_PREALLOCATE;
+        } else {
+            return -1;
+        }
+        cur += len;
+        if (*cur == ',') {
+            cur++;
+        }
+    }
+    *flags = parsed;
+    return 0;
+}
+
+/*
+ * Tells the kernel that 'f' is about to be read front to back. With
+ * 'willneed' set, readahead of the whole file is also started right away.
+ * Advice is only a hint, so failures are ignored.
+ */
+static void io_advise_sequential(FILE *f, int willneed) {
+    if (!(io_policy & IO_ADVISE_SEQUENTIAL)) {
+        return;
+    }
+    posix_fadvise(fileno(f), 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (willneed) {
+        posix_fadvise(fileno(f), 0, 0, POSIX_FADV_WILLNEED);
+    }
+}
+
+/*
+ * Drops the page cache backing everything before the current position of 'f'.
+ * If 'released' is non-NULL, it holds the window boundary (a multiple of
+ * IO_DROP_WINDOW) released up to so far, and nothing happens until the position
+ * passes the next boundary. Without 'released', everything is released at once;
+ * this is meant for the end of the file.
+ *
+ * Dirty pages can't be dropped, so for a file that was 'written', windowed
+ * calls never force a sync of fresh data. Instead, writeback of each new
+ * window is started in the background, and only windows at least one window
+ * behind, which have had that long to reach the disk, are waited on and
+ * dropped. The final call waits for whatever is still in flight.
+ */
+static void io_release_consumed(FILE *f, int written, off_t *released) {
+    if (!(io_policy & IO_DROP_CACHE)) {
+        return;
+    }
+    off_t pos = ftello(f);
+    off_t boundary = (released != NULL) ? pos - pos % IO_DROP_WINDOW : pos;
+    if (boundary <= 0 || (released != NULL && boundary <= *released)) {
+        return;
+    }
+    int fd = fileno(f);
+    if (written && fflush(f) != 0) {
+        return;    // Pages are still dirty, nothing to gain from the advice
+    }
+    int wait_flags =
+        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER;
+
+    if (!written) {
+        posix_fadvise(fd, 0, boundary, POSIX_FADV_DONTNEED);
+    } else if (released == NULL) {
+        if (sync_file_range(fd, 0, pos, wait_flags) == 0) {
+            posix_fadvise(fd, 0, pos, POSIX_FADV_DONTNEED);
+        }
+    } else {
+        off_t settled = boundary - IO_DROP_WINDOW;
+        // A zero length means "to the end of the file" to sync_file_range, so guard it
+        if (settled > 0 && sync_file_range(fd, 0, settled, wait_flags) == 0) {
+            posix_fadvise(fd, 0, settled, POSIX_FADV_DONTNEED);
+        }
+        sync_file_range(fd, *released, boundary - *released, SYNC_FILE_RANGE_WRITE);
+    }
+    if (released != NULL) {
+        *released = boundary;
+    }
+}
+
+/*
+ * Extracted files whose writeback has been started but whose pages haven't
+ * been released yet. Waiting on each file as it is closed would cost one
+ * synchronous flush per file, so files are queued and released together once
+ * another IO_DROP_WINDOW of output has been written.
+ */
+typedef struct {
+    int fds[IO_QUEUE_LEN];    // Duplicated descriptors of the queued files
+    int count;
+    off_t bytes;    // Output written to the queued files
+} io_queue_t;
+
+// Waits for writeback of every file in 'queue', drops their pages and empties it
+static void io_release_queued(io_queue_t *queue) {
+    for (int i = 0; i < queue->count; i++) {
+        if (sync_file_range(queue->fds[i], 0, 0,
+                            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                                SYNC_FILE_RANGE_WAIT_AFTER) == 0) {
+            posix_fadvise(queue->fds[i], 0, 0, POSIX_FADV_DONTNEED);
+        }
+        close(queue->fds[i]);
+    }
+    queue->count = 0;
+    queue->bytes = 0;
+}
 
 /*
- * Helper function to compute the checksum of a tar header block
- * Performs a simple sum over all bytes in the header in accordance with POSIX
- * standard for tar file structure.
+ * Starts writeback of the written file 'f', which is about to be closed, and
+ * adds it to 'queue'. The queue is released once it holds IO_DROP_WINDOW bytes
+ * or IO_QUEUE_LEN files. If the file can't be queued, it is released right away.
  */
-void compute_checksum(tar_header *header) {
-    // Have to initially set header's checksum to "all blanks"
-    memset(header->chksum, ' ', 8);
-    unsigned sum = 0;
-    char *bytes = (char *) header;
-    for (int i = 0; i < sizeof(tar_header); i++) {
-        sum += bytes[i];
-    }
-    snprintf(header->chksum, 8, "%07o", sum);
+static void io_queue_written(io_queue_t *queue, FILE *f) {
+    if (!(io_policy & IO_DROP_CACHE)) {
+        return;
+    }
+    off_t pos = ftello(f);
+    if (pos <= 0 || fflush(f) != 0) {
+        return;
+    }
+    int fd = dup(fileno(f));
+    if (fd == -1) {
+        io_release_queued(queue);
+        io_release_consumed(f, 1, NULL);
+        return;
+    }
+    sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+    queue->fds[queue->count++] = fd;
+    queue->bytes += pos;
+    if (queue->bytes >= IO_DROP_WINDOW || queue->count == IO_QUEUE_LEN) {
+        io_release_queued(queue);
+    }
+}
+
+/*
+ * Reserves 'size' bytes of disk space for the newly created file 'f', so the
+ * file is laid out in as few extents as possible as it is written.
+ * Filesystems without fallocate support simply fall back to growing the file.
+ */
+static void io_preallocate(FILE *f, off_t size) {
+    if (!(io_policy & IO_PREALLOCATE) || size <= 0) {
+        return;
+    }
+    fallocate(fileno(f), 0, 0, size);
 }
 
 /*
@@ -58,11 +235,17 @@ int fill_tar_header(tar_header *header, const char *file_name) {
     }
 
     strncpy(header->name, file_name, 100);    // Name of the file, null-terminated string
-    snprintf(header->mode, 8, "%07o",
-             stat_buf.st_mode & 07777);    // Permissions for file, 0-padded octal
+    // Permissions for file, 0-padded octal
+    int overflow = ENCODE_FIELD(header->mode, stat_buf.st_mode & 07777);
 
-    snprintf(header->uid, 8, "%07o", stat_buf.st_uid);    // Owner ID of the file, 0-padded octal
-    struct passwd *pwd = getpwuid(stat_buf.st_uid);       // Look up name corresponding to owner ID
+    // Name lookups use the reentrant variants, since volumes are written by concurrent threads
+    char lookup_buf[PWGR_BUF_LEN];
+
+    // Owner ID of the file, 0-padded octal
+    overflow |= ENCODE_FIELD(header->uid, stat_buf.st_uid);
+    struct passwd pwd_buf;
+    struct passwd *pwd = NULL;    // Look up name corresponding to owner ID
+    getpwuid_r(stat_buf.st_uid, &pwd_buf, lookup_buf, PWGR_BUF_LEN, &pwd);
     if (pwd == NULL) {
         snprintf(err_msg, MAX_MSG_LEN, "Failed to look up owner name of file %s", file_name);
         perror(err_msg);
@@ -70,8 +253,11 @@ int fill_tar_header(tar_header *header, const char *file_name) {
     }
     strncpy(header->uname, pwd->pw_name, 32);    // Owner name of the file, null-terminated string
 
-    snprintf(header->gid, 8, "%07o", stat_buf.st_gid);    // Group ID of the file, 0-padded octal
-    struct group *grp = getgrgid(stat_buf.st_gid);        // Look up name corresponding to group ID
+    // Group ID of the file, 0-padded octal
+    overflow |= ENCODE_FIELD(header->gid, stat_buf.st_gid);
+    struct group grp_buf;
+    struct group *grp = NULL;    // Look up name corresponding to group ID
+    getgrgid_r(stat_buf.st_gid, &grp_buf, lookup_buf, PWGR_BUF_LEN, &grp);
     if (grp == NULL) {
         snprintf(err_msg, MAX_MSG_LEN, "Failed to look up group name of file %s", file_name);
         perror(err_msg);
@@ -79,22 +265,66 @@ int fill_tar_header(tar_header *header, const char *file_name) {
     }
     strncpy(header->gname, grp->gr_name, 32);    // Group name of the file, null-terminated string
 
-    snprintf(header->size, 12, "%011o",
-             (unsigned) stat_buf.st_size);    // File size, 0-padded octal
-    snprintf(header->mtime, 12, "%011o",
-             (unsigned) stat_buf.st_mtime);    // Modification time, 0-padded octal
+    overflow |= ENCODE_FIELD(header->size, stat_buf.st_size);      // File size, 0-padded octal
+    overflow |= ENCODE_FIELD(header->mtime, stat_buf.st_mtime);    // Modification time
     header->typeflag = REGTYPE;                // File type, always regular file in this project
     strncpy(header->magic, MAGIC, 6);          // Special, standardized sequence of bytes
     memcpy(header->version, "00", 2);          // A bit weird, sidesteps null termination
-    snprintf(header->devmajor, 8, "%07o",
-             major(stat_buf.st_dev));    // Major device number, 0-padded octal
-    snprintf(header->devminor, 8, "%07o",
-             minor(stat_buf.st_dev));    // Minor device number, 0-padded octal
-
-    compute_checksum(header);
+    // Major and minor device numbers, 0-padded octal
+    overflow |= ENCODE_FIELD(header->devmajor, major(stat_buf.st_dev));
+    overflow |= ENCODE_FIELD(header->devminor, minor(stat_buf.st_dev));
+    overflow |= encode_checksum(header);    // Covers every other field, so it comes last
+    if (overflow) {
+        errno = EOVERFLOW;
+        snprintf(err_msg, MAX_MSG_LEN, "Failed to encode header for file %s", file_name);
+        perror(err_msg);
+        return -1;
+    }
     return 0;
 }
 
+/*
+ * Populates 'header' and 'record' with a deletion marker for the file
+ * 'file_name': a pax global extended header holding the single record
+ * "<length> MINITAR.deleted=<file_name>\n". Extraction with minitar removes
+ * the file, while other tars ignore unknown keywords in global headers and so
+ * extract nothing for the marker. 'record' must have room for BLOCK_SIZE bytes.
+ * Returns the length of the record on success or -1 if an error occurs
+ */
+static int fill_deletion_header(tar_header *header, char *record, const char *file_name) {
+    // A record's length counts the digits of the length itself
+    int body_len = strlen(" " DELETED_KEYWORD "=\n") + strlen(file_name);
+    int record_len = body_len + 1;
+    while (record_len != body_len + snprintf(NULL, 0, "%d", record_len)) {
+        record_len = body_len + snprintf(NULL, 0, "%d", record_len);
+    }
+    if (record_len >= BLOCK_SIZE ||
+        snprintf(record, BLOCK_SIZE, "%d " DELETED_KEYWORD "=%s\n", record_len, file_name) !=
+            record_len) {
+        errno = ENAMETOOLONG;
+        perror("Failed to encode deletion marker");
+        return -1;
+    }
+
+    memset(header, 0, sizeof(tar_header));
+    strncpy(header->name, "pax_global_header", 100);
+    int overflow = ENCODE_FIELD(header->mode, 0644);
+    overflow |= ENCODE_FIELD(header->uid, 0);
+    overflow |= ENCODE_FIELD(header->gid, 0);
+    overflow |= ENCODE_FIELD(header->size, record_len);
+    overflow |= ENCODE_FIELD(header->mtime, time(NULL));
+    header->typeflag = XGLTYPE;
+    strncpy(header->magic, MAGIC, 6);
+    memcpy(header->version, "00", 2);
+    overflow |= encode_checksum(header);
+    if (overflow) {
+        errno = EOVERFLOW;
+        perror("Failed to encode deletion marker");
+        return -1;
+    }
+    return record_len;
+}
+
 /*
  * Removes 'nbytes' bytes from the file identified by 'file_name'
  * Returns 0 upon success, -1 upon error
@@ -125,8 +355,149 @@ int remove_trailing_bytes(const char *file_name, size_t nbytes) {
     return 0;
 }
 
+/*
+ * Reads the next member header from 'archive' and decodes it into 'member'.
+ * The archive is left positioned at the start of the member's data.
+ * Returns 1 if a member was read, 0 at the end of the archive, or -1 on error
+ */
+static int read_member_header(FILE *archive, decoded_header_t *member) {
+    tar_header header;
+    if (fread(&header, 1, sizeof(tar_header), archive) != sizeof(tar_header)) {
+        return 0;    // End of archive
+    }
+
+    // Stop if we reach an empty header (end of archive)
+    if (header.name[0] == '\0') {
+        return 0;
+    }
+
+    if (decode_tar_header(&header, member) != 0) {
+        errno = EINVAL;
+        perror("Error parsing archive header");
+        return -1;
+    }
+    return 1;
+}
+
+/*
+ * Moves 'archive' past the data of a member of 'file_size' bytes, including
+ * the padding up to the next 512-byte block.
+ * Returns 0 upon success, -1 upon error
+ */
+static int skip_member_data(FILE *archive, off_t file_size) {
+    // Calc the number of 512-byte blocks needed ie [n/2]
+    off_t blocks_to_skip = (file_size + 511) / 512;
+    return fseeko(archive, blocks_to_skip * BLOCK_SIZE, SEEK_CUR);
+}
+
+/*
+ * Reads the data of 'member', a pax global extended header, from 'archive',
+ * leaving the archive at the next header. If the header is a deletion marker
+ * written by fill_deletion_header, the name of the deleted file is stored in
+ * 'file_name', which must have room for MAX_MEMBER_NAME_LEN bytes.
+ * Returns 1 for a deletion marker, 0 for any other global header, -1 on error
+ */
+static int read_deletion_marker(FILE *archive, const decoded_header_t *member, char *file_name) {
+    // Anything empty or longer than a block isn't a marker
+    if (member->size == 0 || member->size >= BLOCK_SIZE) {
+        if (skip_member_data(archive, member->size) != 0) {
+            perror("Error skipping file block");
+            return -1;
+        }
+        return 0;
+    }
+    char record[BLOCK_SIZE + 1];
+    if (fread(record, 1, BLOCK_SIZE, archive) != BLOCK_SIZE) {
+        perror("Error reading archive data");
+        return -1;
+    }
+    record[member->size] = '\0';
+
+    const char *prefix = " " DELETED_KEYWORD "=";
+    char *name;
+    long record_len = strtol(record, &name, 10);
+    if (record_len != member->size || record[record_len - 1] != '\n' ||
+        strncmp(name, prefix, strlen(prefix)) != 0) {
+        return 0;
+    }
+    name += strlen(prefix);
+    int name_len = record + record_len - 1 - name;
+    if (name_len <= 0 || name_len >= MAX_MEMBER_NAME_LEN) {
+        return 0;
+    }
+    memcpy(file_name, name, name_len);
+    file_name[name_len] = '\0';
+    return 1;
+}
+
+/*
+ * Writes 'header' followed by the contents of the open file 'src' to 'archive',
+ * padding the contents out to a whole number of 512-byte blocks. 'released'
+ * tracks how much of the archive's page cache has been released, as for
+ * io_release_consumed.
+ * Returns 0 upon success, -1 upon error
+ */
+static int write_member(FILE *archive, const tar_header *header, FILE *src, off_t *released) {
+    // Writing the header to the archive (512 bytes)
+    if (fwrite(header, 1, sizeof(tar_header), archive) != sizeof(tar_header)) {
+        perror("Failed to write header to file");
+        return -1;
+    }
+
+    // Writing file contents to the archive in 512-byte blocks
+    char buffer[BLOCK_SIZE] = {0};    // declaring buffer to read file contents in 512 bB
+    size_t bytes_read;
+    off_t copied = 0;
+    while ((bytes_read = fread(buffer, 1, BLOCK_SIZE, src)) > 0) {
+        if (fwrite(buffer, 1, BLOCK_SIZE, archive) !=
+            BLOCK_SIZE) {    // write exactly 512 bytes to archive
+            perror("Failed to write file data");
+            return -1;
+        }
+        memset(buffer, 0, BLOCK_SIZE);    // clears buffer after write to avoid leftover
+        // Large members are released a window at a time as they are copied
+        copied += bytes_read;
+        if (copied % IO_DROP_WINDOW == 0) {
+            io_release_consumed(src, 0, NULL);
+            io_release_consumed(archive, 1, released);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Same as write_member, but with the member's 'size' bytes of contents
+ * already in memory at 'data'.
+ * Returns 0 upon success, -1 upon error
+ */
+static int write_buffered_member(FILE *archive, const tar_header *header, const char *data,
+                                 int size) {
+    if (fwrite(header, 1, sizeof(tar_header), archive) != sizeof(tar_header)) {
+        perror("Failed to write header to file");
+        return -1;
+    }
+    if (fwrite(data, 1, size, archive) != size) {
+        perror("Failed to write file data");
+        return -1;
+    }
+
+    // Zero-fill the rest of the last block
+    char padding[BLOCK_SIZE] = {0};
+    int padding_size = (BLOCK_SIZE - size % BLOCK_SIZE) % BLOCK_SIZE;
+    if (fwrite(padding, 1, padding_size, archive) != padding_size) {
+        perror("Failed to write file data");
+        return -1;
+    }
+    return 0;
+}
+
 // creates a new archive files from given files
 int create_archive(const char *archive_name, const file_list_t *files) {
+    return create_archive_with_deletions(archive_name, files, NULL, NULL);
+}
+
+int create_archive_with_deletions(const char *archive_name, const file_list_t *files,
+                                  const file_list_t *deleted, char *written) {
     // opening archive in write mode, if exists fopen overwrites
     FILE *wr = fopen(archive_name, "w");
     // error check
@@ -134,9 +505,13 @@ int create_archive(const char *archive_name, const file_list_t *files) {
         perror("Failed to open file");
         return -1;
     }
+    off_t released = 0;    // How much of the archive's page cache has been dropped
 
     node_t *cur = files->head;
-    while (cur != NULL) {    // loop through files
+    for (int i = 0; cur != NULL; i++) {    // loop through files
+        if (written != NULL) {
+            written[i] = 0;
+        }
         // skip if the cur file is the archive
         if (strcmp(cur->name, archive_name) == 0) {
             cur = cur->next;
@@ -150,6 +525,7 @@ int create_archive(const char *archive_name, const file_list_t *files) {
             cur = cur->next;
             continue;
         }
+        io_advise_sequential(f, 1);
 
         // Creating and filling the tar header
         tar_header header;
@@ -158,31 +534,32 @@ int create_archive(const char *archive_name, const file_list_t *files) {
             cur = cur->next;
             return -1;
         }
-        // Writing the header to the archive (512 bytes)
-        if (fwrite(&header, 1, sizeof(tar_header), wr) < 0) {
-            perror("Failed to write header to file");
+        // Writing the header and file contents to the archive
+        if (write_member(wr, &header, f, &released) != 0) {
             fclose(f);
             fclose(wr);
             return -1;
         }
-
-        // Writing file contents to the archive in 512-byte blocks
-        char buffer[BLOCK_SIZE] = {0};    // declaring buffer to read file contents in 512 bB
-        size_t bytes_read;
-        while ((bytes_read = fread(buffer, 1, BLOCK_SIZE, f)) > 0) {
-            if (fwrite(buffer, 1, BLOCK_SIZE, wr) !=
-                BLOCK_SIZE) {    // write exactly 512 bytes to archive
-                perror("Failed to write file data");
-                fclose(f);
-                fclose(wr);
-                return -1;
-            }
-            memset(buffer, 0, BLOCK_SIZE);    // clears buffer after write to avoid leftover
+        if (written != NULL) {
+            written[i] = 1;
         }
+        io_release_consumed(f, 0, NULL);
+        io_release_consumed(wr, 1, &released);
         fclose(f);
         cur = cur->next;    // on to the next file
     }
 
+    // Deletion markers follow the member files
+    for (cur = (deleted != NULL) ? deleted->head : NULL; cur != NULL; cur = cur->next) {
+        tar_header header;
+        char record[BLOCK_SIZE];
+        int record_len = fill_deletion_header(&header, record, cur->name);
+        if (record_len == -1 || write_buffered_member(wr, &header, record, record_len) != 0) {
+            fclose(wr);
+            return -1;
+        }
+    }
+
     char emptyBlock[BLOCK_SIZE] = {0};    // creating a block of 512 bytes of zeros
     if (fwrite(emptyBlock, 1, BLOCK_SIZE, wr) !=
         BLOCK_SIZE) {    // Write first empty block (TAR format requirement)
@@ -195,6 +572,7 @@ int create_archive(const char *archive_name, const file_list_t *files) {
         fclose(wr);
         return -1;
     }
+    io_release_consumed(wr, 1, NULL);
 
     if (fclose(wr) != 0) {
         perror("Failed to close archive file");
@@ -222,6 +600,7 @@ int append_files_to_archive(const char *archive_name, const file_list_t *files)
         fclose(wr);
         return -1;
     }
+    off_t released = 0;    // How much of the archive's page cache has been dropped
 
     node_t *cur = files->head;
     while (cur != NULL) {
@@ -235,6 +614,7 @@ int append_files_to_archive(const char *archive_name, const file_list_t *files)
             cur = cur->next;
             continue;
         }
+        io_advise_sequential(toRead, 1);
 
         // creating and filling tar header
         tar_header header;
@@ -244,27 +624,14 @@ int append_files_to_archive(const char *archive_name, const file_list_t *files)
             return -1;
         }
 
-        // Writing the header to the archive (512 bytes)
-        if (fwrite(&header, 1, sizeof(tar_header), wr) < 0) {
-            perror("Failed to write header to file");
+        // Writing the header and file contents to the archive
+        if (write_member(wr, &header, toRead, &released) != 0) {
             fclose(toRead);
             fclose(wr);
             return -1;
         }
-
-        // Writing file contents to the archive in 512-byte blocks
-        char buffer[BLOCK_SIZE] = {0};    // declaring buffer to read file contents in 512 bB
-        size_t bytes_read;
-        while ((bytes_read = fread(buffer, 1, BLOCK_SIZE, toRead)) > 0) {
-            if (fwrite(buffer, 1, BLOCK_SIZE, wr) !=
-                BLOCK_SIZE) {    // write exactly 512 bytes to archive
-                perror("Failed to write file contents");
-                fclose(toRead);
-                fclose(wr);
-                return -1;
-            }
-            memset(buffer, 0, BLOCK_SIZE);    // clears buffer after write to avoid leftover
-        }
+        io_release_consumed(toRead, 0, NULL);
+        io_release_consumed(wr, 1, &released);
         fclose(toRead);
         cur = cur->next;    // on to the next file
     }
@@ -283,6 +650,7 @@ int append_files_to_archive(const char *archive_name, const file_list_t *files)
         fclose(wr);
         return -1;
     }
+    io_release_consumed(wr, 1, NULL);
 
     if (fclose(wr) != 0) {
         perror("Failed to close archive file");
@@ -291,6 +659,217 @@ int append_files_to_archive(const char *archive_name, const file_list_t *files)
     return 0;
 }
 
+// Where a member stands in create_archive_in_read_order
+#define MEMBER_UNREAD 0
+#define MEMBER_BUFFERED 1
+#define MEMBER_DONE 2    // Written to the archive, or skipped
+
+// A member waiting in the reorder buffer for its turn to be written
+typedef struct {
+    int state;
+    tar_header header;
+    char *data;
+    int size;
+} pending_member_t;
+
+// Bookkeeping for create_archive_in_read_order
+typedef struct {
+    FILE *archive;
+    off_t released;    // How much of the archive's page cache has been dropped
+    const char **names;
+    pending_member_t *pending;
+    int num_members;
+    int next;                  // Next member, in list order, due to be written
+    long long buffered_size;    // Bytes of member data currently held in memory
+} reorder_state_t;
+
+/*
+ * Writes member 'index' to the archive straight from disk, the same way
+ * create_archive does. Files that can't be opened are skipped.
+ * Returns 0 upon success, -1 upon error
+ */
+static int write_member_from_disk(reorder_state_t *state, int index) {
+    const char *file_name = state->names[index];
+    state->pending[index].state = MEMBER_DONE;
+
+    FILE *f = fopen(file_name, "r");
+    if (f == NULL) {
+        perror("Failed to open a file");
+        return 0;
+    }
+    io_advise_sequential(f, 1);
+
+    tar_header header;
+    if (fill_tar_header(&header, file_name) != 0 ||
+        write_member(state->archive, &header, f, &state->released) != 0) {
+        fclose(f);
+        return -1;
+    }
+    io_release_consumed(f, 0, NULL);
+    io_release_consumed(state->archive, 1, &state->released);
+    fclose(f);
+    return 0;
+}
+
+/*
+ * Reads member 'index' into the reorder buffer, if there is room for it.
+ * Files that can't be opened are skipped.
+ * Returns 1 if the member was buffered or skipped, 0 if it doesn't fit, -1 upon error
+ */
+static int buffer_member(reorder_state_t *state, int index) {
+    const char *file_name = state->names[index];
+    pending_member_t *member = &state->pending[index];
+
+    char err_msg[MAX_MSG_LEN];
+    struct stat stat_buf;
+    if (stat(file_name, &stat_buf) != 0) {
+        snprintf(err_msg, MAX_MSG_LEN, "Failed to stat file %s", file_name);
+        perror(err_msg);
+        return -1;
+    }
+    if (state->buffered_size + stat_buf.st_size > REORDER_BUFFER_SIZE) {
+        return 0;
+    }
+
+    FILE *f = fopen(file_name, "r");
+    if (f == NULL) {
+        perror("Failed to open a file");
+        member->state = MEMBER_DONE;
+        return 1;
+    }
+    io_advise_sequential(f, 1);
+
+    if (fill_tar_header(&member->header, file_name) != 0) {
+        fclose(f);
+        return -1;
+    }
+    member->size = stat_buf.st_size;
+    member->data = malloc(member->size > 0 ? member->size : 1);
+    if (member->data == NULL) {
+        perror("Failed to allocate reorder buffer");
+        fclose(f);
+        return -1;
+    }
+    if (fread(member->data, 1, member->size, f) != member->size) {
+        snprintf(err_msg, MAX_MSG_LEN, "Failed to read file %s", file_name);
+        perror(err_msg);
+        free(member->data);
+        member->data = NULL;
+        fclose(f);
+        return -1;
+    }
+    io_release_consumed(f, 0, NULL);
+    fclose(f);
+
+    member->state = MEMBER_BUFFERED;
+    state->buffered_size += member->size;
+    return 1;
+}
+
+/*
+ * Writes out every buffered member that is now due, advancing 'state->next'
+ * past anything already written or skipped.
+ * Returns 0 upon success, -1 upon error
+ */
+static int drain_reorder_buffer(reorder_state_t *state) {
+    while (state->next < state->num_members) {
+        pending_member_t *member = &state->pending[state->next];
+        if (member->state == MEMBER_UNREAD) {
+            break;
+        }
+        if (member->state == MEMBER_BUFFERED) {
+            if (write_buffered_member(state->archive, &member->header, member->data,
+                                      member->size) != 0) {
+                return -1;
+            }
+            io_release_consumed(state->archive, 1, &state->released);
+            free(member->data);
+            member->data = NULL;
+            member->state = MEMBER_DONE;
+            state->buffered_size -= member->size;
+        }
+        state->next++;
+    }
+    return 0;
+}
+
+int create_archive_in_read_order(const char *archive_name, const file_list_t *files,
+                                 const int *read_order) {
+    reorder_state_t state;
+    state.num_members = files->size;
+    state.next = 0;
+    state.buffered_size = 0;
+    state.released = 0;
+    state.names = malloc((files->size + 1) * sizeof(char *));
+    state.pending = calloc(files->size + 1, sizeof(pending_member_t));
+    if (state.names == NULL || state.pending == NULL) {
+        perror("Failed to allocate reorder buffer");
+        free(state.names);
+        free(state.pending);
+        return -1;
+    }
+
+    int index = 0;
+    for (node_t *cur = files->head; cur != NULL; cur = cur->next, index++) {
+        state.names[index] = cur->name;
+        // skip if the cur file is the archive
+        if (strcmp(cur->name, archive_name) == 0) {
+            state.pending[index].state = MEMBER_DONE;
+        }
+    }
+
+    // opening archive in write mode, if exists fopen overwrites
+    state.archive = fopen(archive_name, "w");
+    if (state.archive == NULL) {
+        perror("Failed to open file");
+        free(state.names);
+        free(state.pending);
+        return -1;
+    }
+
+    // Files are read in 'read_order'. A file that isn't due yet waits in memory;
+    // once the buffer is full, the member that is due is read directly instead.
+    int ret = drain_reorder_buffer(&state);
+    for (int i = 0; i < state.num_members && ret == 0; i++) {
+        index = read_order[i];
+        while (ret == 0 && state.pending[index].state == MEMBER_UNREAD) {
+            if (index == state.next) {
+                ret = write_member_from_disk(&state, index);
+            } else {
+                int buffered = buffer_member(&state, index);
+                if (buffered == -1) {
+                    ret = -1;
+                } else if (buffered == 0) {
+                    ret = write_member_from_disk(&state, state.next);
+                }
+            }
+            if (ret == 0) {
+                ret = drain_reorder_buffer(&state);
+            }
+        }
+    }
+
+    if (ret == 0) {
+        char emptyBlocks[NUM_TRAILING_BLOCKS * BLOCK_SIZE] = {0};
+        if (fwrite(emptyBlocks, 1, sizeof(emptyBlocks), state.archive) != sizeof(emptyBlocks)) {
+            perror("Failed to write end of archive blocks");
+            ret = -1;
+        }
+        io_release_consumed(state.archive, 1, NULL);
+    }
+
+    for (int i = 0; i < state.num_members; i++) {
+        free(state.pending[i].data);
+    }
+    free(state.names);
+    free(state.pending);
+    if (fclose(state.archive) != 0 && ret == 0) {
+        perror("Failed to close archive file");
+        ret = -1;
+    }
+    return ret;
+}
+
 int get_archive_file_list(const char *archive_name, file_list_t *files) {
     // Check for valid arguments
     if (archive_name == NULL || files == NULL) {
@@ -304,49 +883,37 @@ int get_archive_file_list(const char *archive_name, file_list_t *files) {
         perror("Error opening archive");
         return -1;
     }
+    // Only headers are read here, so member data isn't worth prefetching
+    io_advise_sequential(archive, 0);
 
     file_list_init(files);
 
-    while (1) {
-        tar_header header;
-        if (fread(&header, 1, sizeof(header), archive) != sizeof(header)) {
-            break;    // End of archive
-        }
-
-        // Stop if we reach an empty header (end of archive)
-        if (header.name[0] == '\0') {
-            break;
-        }
-
-        // Add file name to the list
-        if (file_list_add(files, header.name) != 0) {
+    decoded_header_t member;
+    int status;
+    while ((status = read_member_header(archive, &member)) == 1) {
+        // Global headers, deletion markers included, describe no file the archive contains
+        if (member.typeflag != XGLTYPE && file_list_add(files, member.name) != 0) {
             perror("Error adding file to list");
             fclose(archive);
             file_list_clear(files);
             return -1;
         }
 
-        int file_size = 0;
-        // Parse file size from octal format
-        if (sscanf(header.size, "%o", &file_size) != 1) {
-            perror("Error parsing file size");
-            fclose(archive);
-            file_list_clear(files);
-            return -1;
-        }
-
-        // Calc the number of 512-byte blocks needed ie [n/2]
-        int blocks_to_skip = (file_size + 511) / 512;
-
         // Skip past file contents
-        if (fseek(archive, blocks_to_skip * BLOCK_SIZE, SEEK_CUR) != 0) {
+        if (skip_member_data(archive, member.size) != 0) {
             perror("Error skipping file block");
             fclose(archive);
             file_list_clear(files);
             return -1;
         }
     }
+    if (status == -1) {
+        fclose(archive);
+        file_list_clear(files);
+        return -1;
+    }
 
+    io_release_consumed(archive, 0, NULL);
     fclose(archive);
     return 0;
 }
@@ -363,39 +930,54 @@ int extract_files_from_archive(const char *archive_name) {
         perror("Error opening archive file");
         return -1;
     }
+    io_advise_sequential(archive, 1);
+    off_t released = 0;    // How much of the archive's page cache has been dropped
+    io_queue_t queue;      // Extracted files waiting for their page cache to be dropped
+    queue.count = 0;
+    queue.bytes = 0;
 
     // Initialize the list to track extracted files
     file_list_t extracted_files;
     file_list_init(&extracted_files);
 
-    tar_header header;
+    decoded_header_t member;
+    int status;
 
     // Iterate through each file entry in the archive
-    while (fread(&header, 1, sizeof(header), archive) == sizeof(header)) {
-        if (header.name[0] == '\0') {
-            break;    // End of archive (null terminator)
-        }
+    while ((status = read_member_header(archive, &member)) == 1) {
+        off_t file_size = member.size;
 
-        // Read file size from header (stored in octal format)
-        int file_size = 0;
-        if (sscanf(header.size, "%o", &file_size) != 1) {
-            perror("Error reading file size from header");
-            file_list_clear(&extracted_files);
-            fclose(archive);
-            return -1;
+        // A deletion marker removes the file left behind by an earlier archive
+        if (member.typeflag == XGLTYPE) {
+            char deleted_name[MAX_MEMBER_NAME_LEN];
+            int marker = read_deletion_marker(archive, &member, deleted_name);
+            if (marker == 1 && unlink(deleted_name) != 0 && errno != ENOENT) {
+                perror("Error removing deleted file");
+                marker = -1;
+            }
+            if (marker == -1) {
+                io_release_queued(&queue);
+                file_list_clear(&extracted_files);
+                fclose(archive);
+                return -1;
+            }
+            continue;
         }
 
         // Open the output file for writing (overwrite if exists)
-        FILE *out_file = fopen(header.name, "w");
+        FILE *out_file = fopen(member.name, "w");
         if (out_file == NULL) {
             perror("Error creating output file");
+            io_release_queued(&queue);
             file_list_clear(&extracted_files);
             fclose(archive);
             return -1;
         }
+        io_preallocate(out_file, file_size);    // Reserve the whole file up front
 
         char buffer[BLOCK_SIZE];
-        int remaining_size = file_size;
+        off_t remaining_size = file_size;
+        off_t out_released = 0;    // How much of the output file's page cache has been dropped
 
         // Read and write file data in chunks
         while (remaining_size > 0) {
@@ -410,6 +992,7 @@ int extract_files_from_archive(const char *archive_name) {
             if (fread(buffer, 1, chunk_size, archive) != chunk_size) {
                 perror("Error reading archive data");
                 fclose(out_file);
+                io_release_queued(&queue);
                 file_list_clear(&extracted_files);
                 fclose(archive);
                 return -1;
@@ -419,37 +1002,293 @@ int extract_files_from_archive(const char *archive_name) {
             if (fwrite(buffer, 1, chunk_size, out_file) != chunk_size) {
                 perror("Error writing to output file");
                 fclose(out_file);
+                io_release_queued(&queue);
                 file_list_clear(&extracted_files);
                 fclose(archive);
                 return -1;
             }
 
             remaining_size -= chunk_size;
+            // Large files are released a window at a time as they are written
+            if ((file_size - remaining_size) % IO_DROP_WINDOW == 0) {
+                io_release_consumed(out_file, 1, &out_released);
+                io_release_consumed(archive, 0, &released);
+            }
         }
 
+        io_queue_written(&queue, out_file);
         fclose(out_file);    // Close the extracted file
 
         // Add file to extracted list (ensuring latest version is written)
-        if (file_list_add(&extracted_files, header.name) != 0) {
+        if (file_list_add(&extracted_files, member.name) != 0) {
             perror("Error tracking extracted file");
+            io_release_queued(&queue);
             file_list_clear(&extracted_files);
             fclose(archive);
             return -1;
         }
 
         // Align archive pointer to 512-byte blocks
-        int blocks_needed = (file_size + 511) / 512;    // Ensures [file_size / 512]
+        off_t blocks_needed = (file_size + 511) / 512;    // Ensures [file_size / 512]
         int padding = (blocks_needed * 512) - file_size;
 
         if (fseek(archive, padding, SEEK_CUR) != 0) {
             perror("Error seeking archive");
+            io_release_queued(&queue);
             file_list_clear(&extracted_files);
             fclose(archive);
             return -1;
         }
+        io_release_consumed(archive, 0, &released);
     }
+    if (status == -1) {
+        io_release_queued(&queue);
+        file_list_clear(&extracted_files);
+        fclose(archive);
+        return -1;
+    }
+    io_release_queued(&queue);
+    io_release_consumed(archive, 0, NULL);
     file_list_clear(&extracted_files);
     fclose(archive);
 
     return 0;
 }
+
+// A member found while scanning an archive for diff_archive
+typedef struct {
+    char name[MAX_MEMBER_NAME_LEN];
+    off_t data_offset;    // Where the member's contents start in the archive
+    off_t size;
+    unsigned long long mtime;
+    char typeflag;
+    int index;    // Position of the member in the archive
+} archive_member_t;
+
+// Orders members by name, then by position so the latest version of a name comes last
+static int compare_member_names(const void *a, const void *b) {
+    const archive_member_t *m1 = a;
+    const archive_member_t *m2 = b;
+    int cmp = strcmp(m1->name, m2->name);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return m1->index - m2->index;
+}
+
+// Orders members by their position in the archive
+static int compare_member_positions(const void *a, const void *b) {
+    return ((const archive_member_t *) a)->index - ((const archive_member_t *) b)->index;
+}
+
+/*
+ * Compares the contents of 'member', found in 'archive', against the file of the
+ * same name. The size is checked again on the open file, and the file is read
+ * with pread in large chunks alongside the archive data, stopping at the first
+ * difference. A file that changes size while being compared reads short and is
+ * reported as differing, rather than faulting as a memory mapping would.
+ * Returns 0 if the contents match, 1 if they differ, -1 if an error occurred
+ */
+static int compare_member_contents(FILE *archive, const archive_member_t *member) {
+    char err_msg[MAX_MSG_LEN];
+    int fd = open(member->name, O_RDONLY);
+    if (fd == -1) {
+        snprintf(err_msg, MAX_MSG_LEN, "Failed to open file %.100s", member->name);
+        perror(err_msg);
+        return -1;
+    }
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) != 0) {
+        snprintf(err_msg, MAX_MSG_LEN, "Failed to stat file %.100s", member->name);
+        perror(err_msg);
+        close(fd);
+        return -1;
+    }
+    if (stat_buf.st_size != member->size) {
+        close(fd);
+        return 1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    if (fseeko(archive, member->data_offset, SEEK_SET) != 0) {
+        perror("Error seeking archive");
+        close(fd);
+        return -1;
+    }
+
+    char buffer[DIFF_CHUNK_SIZE];
+    char file_buffer[DIFF_CHUNK_SIZE];
+    int ret = 0;
+    off_t compared = 0;
+    while (compared < member->size) {
+        off_t chunk_size = member->size - compared;
+        if (chunk_size > DIFF_CHUNK_SIZE) {
+            chunk_size = DIFF_CHUNK_SIZE;
+        }
+        if (fread(buffer, 1, chunk_size, archive) != chunk_size) {
+            perror("Error reading archive data");
+            ret = -1;
+            break;
+        }
+        ssize_t bytes_read = pread(fd, file_buffer, chunk_size, compared);
+        if (bytes_read == -1) {
+            snprintf(err_msg, MAX_MSG_LEN, "Failed to read file %.100s", member->name);
+            perror(err_msg);
+            ret = -1;
+            break;
+        }
+        if (bytes_read != chunk_size || memcmp(buffer, file_buffer, chunk_size) != 0) {
+            ret = 1;
+            break;
+        }
+        compared += chunk_size;
+    }
+
+    close(fd);
+    return ret;
+}
+
+int diff_archive(const char *archive_name, const file_list_t *files) {
+    FILE *archive = fopen(archive_name, "r");
+    if (archive == NULL) {
+        perror("Error opening archive");
+        return -1;
+    }
+    io_advise_sequential(archive, 0);
+
+    // Collect every member header, the same way listing the archive does
+    int num_members = 0;
+    int capacity = 64;
+    archive_member_t *members = malloc(capacity * sizeof(archive_member_t));
+    if (members == NULL) {
+        perror("Failed to allocate member table");
+        fclose(archive);
+        return -1;
+    }
+
+    decoded_header_t decoded;
+    int status;
+    while ((status = read_member_header(archive, &decoded)) == 1) {
+        // A deletion marker stands for the deleted file; other global headers are skipped
+        int marker = 0;
+        if (decoded.typeflag == XGLTYPE) {
+            marker = read_deletion_marker(archive, &decoded, decoded.name);
+            if (marker == -1) {
+                status = -1;
+                break;
+            }
+            if (marker == 0) {
+                continue;
+            }
+        }
+
+        if (num_members == capacity) {
+            capacity *= 2;
+            archive_member_t *grown = realloc(members, capacity * sizeof(archive_member_t));
+            if (grown == NULL) {
+                perror("Failed to allocate member table");
+                status = -1;
+                break;
+            }
+            members = grown;
+        }
+        archive_member_t *member = &members[num_members];
+        strcpy(member->name, decoded.name);
+        member->data_offset = ftello(archive);
+        member->size = decoded.size;
+        member->mtime = decoded.mtime;
+        member->typeflag = decoded.typeflag;
+        member->index = num_members;
+        num_members++;
+
+        if (!marker && skip_member_data(archive, member->size) != 0) {
+            perror("Error skipping file block");
+            status = -1;
+            break;
+        }
+    }
+    if (status == -1) {
+        free(members);
+        fclose(archive);
+        return -1;
+    }
+
+    // Only the most recently added version of each name is live, unless it was deleted
+    qsort(members, num_members, sizeof(archive_member_t), compare_member_names);
+    int num_live = 0;
+    for (int i = 0; i < num_members; i++) {
+        if (i + 1 < num_members && strcmp(members[i].name, members[i + 1].name) == 0) {
+            continue;
+        }
+        if (members[i].typeflag == XGLTYPE) {
+            continue;
+        }
+        members[num_live++] = members[i];
+    }
+
+    // Files named on the command line that the archive doesn't have were added
+    int differences = 0;
+    for (node_t *cur = files->head; cur != NULL; cur = cur->next) {
+        if (strcmp(cur->name, archive_name) == 0) {
+            continue;
+        }
+        // Binary search, since the live members are still sorted by name
+        int found = 0;
+        for (int lo = 0, hi = num_live - 1; lo <= hi && !found;) {
+            int mid = lo + (hi - lo) / 2;
+            int cmp = strcmp(cur->name, members[mid].name);
+            if (cmp == 0) {
+                found = 1;
+            } else if (cmp < 0) {
+                hi = mid - 1;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        if (found) {
+            continue;
+        }
+        // Only a file that actually exists can have been added
+        struct stat stat_buf;
+        if (stat(cur->name, &stat_buf) != 0) {
+            char err_msg[MAX_MSG_LEN];
+            snprintf(err_msg, MAX_MSG_LEN, "Failed to stat file %.100s", cur->name);
+            perror(err_msg);
+            continue;
+        }
+        printf("Added: %s\n", cur->name);
+        differences++;
+    }
+
+    // Report removed and modified members in archive order
+    qsort(members, num_live, sizeof(archive_member_t), compare_member_positions);
+    for (int i = 0; i < num_live; i++) {
+        archive_member_t *member = &members[i];
+        struct stat stat_buf;
+        if (stat(member->name, &stat_buf) != 0) {
+            printf("Removed: %s\n", member->name);
+            differences++;
+            continue;
+        }
+
+        // Cheap metadata checks first, contents only when those agree
+        int modified = stat_buf.st_size != member->size ||
+                       (unsigned long long) stat_buf.st_mtime != member->mtime;
+        if (!modified) {
+            modified = compare_member_contents(archive, member);
+            if (modified == -1) {
+                free(members);
+                fclose(archive);
+                return -1;
+            }
+        }
+        if (modified) {
+            printf("Modified: %s\n", member->name);
+            differences++;
+        }
+    }
+
+    free(members);
+    fclose(archive);
+    return differences;
+}
@@ -41,6 +41,30 @@ typedef struct {
     char padding[12];
 } tar_header;
 
+// I/O policy flags, combined with '|' and passed to set_io_policy
+// Advise the kernel that inputs and archives are read sequentially, prefetching them
+#define IO_ADVISE_SEQUENTIAL 0x1
+// Drop page cache for file data once it has been consumed (written data once it is on disk)
+#define IO_DROP_CACHE 0x2
+// Preallocate each extracted file to its full size before writing it
+#define IO_PREALLOCATE 0x4
+// Policy used unless set_io_policy is called
+#define IO_POLICY_DEFAULT (IO_ADVISE_SEQUENTIAL | IO_PREALLOCATE)
+
+/*
+ * Set the I/O policy used by all archive operations to 'flags'.
+ * The policy is process-wide and should be set before any operation starts.
+ */
+void set_io_policy(int flags);
+
+/*
+ * Parse an I/O policy from the command line into 'flags'. Accepts "none",
+ * "default", "bulk" (every flag, for jobs that shouldn't disturb the page cache),
+ * or a comma-separated list of "seq", "drop" and "prealloc".
+ * This function should return 0 upon success or -1 if 'spec' is not recognized.
+ */
+int parse_io_policy(const char *spec, int *flags);
+
 /*
  * Create a new archive file with the name 'archive_name'.
  * The archive should contain all files stored in the 'files' list.
@@ -52,6 +76,30 @@ typedef struct {
  */
 int create_archive(const char *archive_name, const file_list_t *files);
 
+/*
+ * Same as create_archive, but after the member files, the archive also records
+ * a deletion marker for each name in 'deleted' (which may be NULL). Extracting
+ * the archive removes those files; listing the archive omits them. Markers are
+ * pax global headers with a vendor keyword, which other tars ignore.
+ * Files that can't be opened are skipped, as with create_archive. If 'written'
+ * is non-NULL, it must have room for 'files->size' flags, and written[i] is set
+ * to 1 if the i-th file of 'files' was archived, 0 if it was skipped.
+ * This function should return 0 upon success or -1 if an error occurred.
+ */
+int create_archive_with_deletions(const char *archive_name, const file_list_t *files,
+                                  const file_list_t *deleted, char *written);
+
+/*
+ * Same as create_archive, but the member files are read in the order given by
+ * 'read_order', which lists positions in 'files' (see compute_read_order in
+ * layout.h). Members are still written to the archive in list order: files
+ * read ahead of their turn are held in a bounded in-memory buffer, and when
+ * that buffer is full the next member in list order is read directly instead.
+ * This function should return 0 upon success or -1 if an error occurred.
+ */
+int create_archive_in_read_order(const char *archive_name, const file_list_t *files,
+                                 const int *read_order);
+
 /*
  * Append each file specified in 'files' to the archive with the name 'archive_name'.
  * You can assume in this project that at least one new file to append is specified.
@@ -79,4 +127,16 @@ int get_archive_file_list(const char *archive_name, file_list_t *files);
  */
 int extract_files_from_archive(const char *archive_name);
 
+/*
+ * Compare the archive identified by 'archive_name' against the file system
+ * without writing anything. For the most recently added version of each member,
+ * reports the member as removed if the file no longer exists, or as modified if
+ * its size, modification time or contents differ from the archived version.
+ * Files in 'files' that exist but are not in the archive are reported as added;
+ * names that don't exist are reported as errors and otherwise ignored.
+ * This function should return the number of differences found, or -1 if an
+ * error occurred.
+ */
+int diff_archive(const char *archive_name, const file_list_t *files);
+
 #endif    // _MINITAR_H
@@ -1,28 +1,70 @@
 /*partners worked on this project: Abdirahman Hassan (hassa878) and Youssef Abdulle (abdul664)*/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "file_list.h"
+#include "layout.h"
 #include "minitar.h"
+#include "snapshot.h"
+#include "volumes.h"
 
 int main(int argc, char **argv) {
     if (argc < 4) {
-        printf("Usage: %s -c|a|t|u|x -f ARCHIVE [FILE...]\n", argv[0]);
+        printf("Usage: %s -c|a|t|u|x|d -f ARCHIVE [-V VOLUMES] [-I POLICY] [-O ORDER [-S]] "
+               "[-g SNAPSHOT] [FILE...]\n",
+               argv[0]);
         return 0;
     }
 
     file_list_t files;
     file_list_init(&files);
+    node_t *files_tail = NULL;    // Last name added to 'files'
 
     // TODO: Parse command-line arguments and invoke functions from 'minitar.h'
     // to execute archive ops
     char *op = argv[1];
-    char *archive_name = argv[3];
+    char *archive_name = NULL;
+    char *volume_spec = NULL;    // Volume count or directory list for a sharded archive
+    int read_order_mode = READ_ORDER_NONE;    // Order to read input files in for create
+    int keep_order = 0;                       // Still write members in command-line order
+    char *snapshot_path = NULL;               // Snapshot for a listed-incremental create
+
+    // Parsing options, anything that isn't an option is added to the files list
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            archive_name = argv[++i];
+        } else if (strcmp(argv[i], "-V") == 0 && i + 1 < argc) {
+            volume_spec = argv[++i];
+        } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+            int io_flags;
+            if (parse_io_policy(argv[++i], &io_flags) != 0) {
+                printf("Error: Unknown I/O policy %s", argv[i]);
+                file_list_clear(&files);
+                return 1;
+            }
+            set_io_policy(io_flags);
+        } else if (strcmp(argv[i], "-O") == 0 && i + 1 < argc) {
+            read_order_mode = parse_read_order(argv[++i]);
+            if (read_order_mode == -1) {
+                printf("Error: Unknown read order %s", argv[i]);
+                file_list_clear(&files);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-S") == 0) {
+            keep_order = 1;
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else {
+            file_list_append(&files, &files_tail, argv[i]);
+        }
+    }
 
-    // Adding files to list
-    for (int i = 4; i < argc; i++) {
-        file_list_add(&files, argv[i]);
+    if (archive_name == NULL) {
+        printf("Error: No archive specified");
+        file_list_clear(&files);
+        return 1;
     }
 
 
@@ -33,7 +75,43 @@ int main(int argc, char **argv) {
             file_list_clear(&files);
             return 1;
         }
-        if (create_archive(archive_name, &files) == -1) {
+        if (keep_order && volume_spec != NULL) {
+            printf("Error: -S cannot be combined with -V");
+            file_list_clear(&files);
+            return 1;
+        }
+        if (snapshot_path != NULL && (volume_spec != NULL || keep_order)) {
+            printf("Error: -g cannot be combined with -V or -S");
+            file_list_clear(&files);
+            return 1;
+        }
+
+        // Optionally sort inputs by on-disk location so they're read near-sequentially
+        int *read_order = NULL;
+        if (read_order_mode != READ_ORDER_NONE) {
+            read_order = malloc((files.size + 1) * sizeof(int));
+            if (read_order == NULL ||
+                compute_read_order(&files, read_order_mode, read_order) != 0 ||
+                (!keep_order && reorder_file_list(&files, read_order) != 0)) {
+                printf("Error: Failed to order files");
+                free(read_order);
+                file_list_clear(&files);
+                return 1;
+            }
+        }
+
+        int ret;
+        if (snapshot_path != NULL) {
+            ret = create_incremental_archive(archive_name, &files, snapshot_path);
+        } else if (volume_spec != NULL) {
+            ret = create_volume_archive(archive_name, &files, volume_spec);
+        } else if (read_order != NULL && keep_order) {
+            ret = create_archive_in_read_order(archive_name, &files, read_order);
+        } else {
+            ret = create_archive(archive_name, &files);
+        }
+        free(read_order);
+        if (ret == -1) {
             printf("Error: Failed to create archive");
             file_list_clear(&files);
             return 1;
@@ -46,6 +124,11 @@ int main(int argc, char **argv) {
             file_list_clear(&files);
             return 1;
         }
+        if (is_volume_manifest(archive_name)) {
+            printf("Error: Cannot append to a multi-volume archive");
+            file_list_clear(&files);
+            return 1;
+        }
         if (append_files_to_archive(archive_name, &files) == -1) {
             printf("Error: Failed to append files");
             file_list_clear(&files);
@@ -57,9 +140,16 @@ int main(int argc, char **argv) {
         file_list_t archive_files;
         file_list_init(&archive_files);
 
-        if (get_archive_file_list(archive_name, &archive_files) == -1) {
+        int ret;
+        if (is_volume_manifest(archive_name)) {
+            ret = get_volume_archive_file_list(archive_name, &archive_files);
+        } else {
+            ret = get_archive_file_list(archive_name, &archive_files);
+        }
+        if (ret == -1) {
             printf("Error: Failed to read archive");
             file_list_clear(&archive_files);
+            file_list_clear(&files);
             return 1;
         }
 
@@ -87,6 +177,11 @@ int main(int argc, char **argv) {
             return 1;
         }
         fclose(update_file);
+        if (is_volume_manifest(archive_name)) {
+            printf("Error: Cannot update a multi-volume archive");
+            file_list_clear(&files);
+            return 1;
+        }
 
         file_list_t archive_files;
         file_list_init(&archive_files);
@@ -118,8 +213,33 @@ int main(int argc, char **argv) {
 
     // Extract from archive
     } else if (strcmp(op, "-x") == 0) {
-        if (extract_files_from_archive(archive_name) == -1) {
+        int ret;
+        if (is_volume_manifest(archive_name)) {
+            ret = extract_files_from_volume_archive(archive_name);
+        } else {
+            ret = extract_files_from_archive(archive_name);
+        }
+        if (ret == -1) {
             printf("Error: Failed to extract files from archive");
+            file_list_clear(&files);
+            return 1;
+        }
+
+    // Compare archive against the file system
+    } else if (strcmp(op, "-d") == 0) {
+        if (is_volume_manifest(archive_name)) {
+            printf("Error: Cannot diff a multi-volume archive");
+            file_list_clear(&files);
+            return 1;
+        }
+        int differences = diff_archive(archive_name, &files);
+        if (differences == -1) {
+            printf("Error: Failed to compare archive");
+            file_list_clear(&files);
+            return 1;
+        }
+        if (differences > 0) {
+            file_list_clear(&files);
             return 1;
         }
 
@@ -0,0 +1,391 @@
+#include "snapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "minitar.h"
+
+#define MAX_MSG_LEN 128
+
+// 32-bit FNV-1a hash of a path
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *) name; *p != '\0'; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+int snapshot_load(const char *path, snapshot_t *snapshot) {
+    memset(snapshot, 0, sizeof(snapshot_t));
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        if (errno == ENOENT) {
+            return 0;    // No previous run
+        }
+        perror("Failed to open snapshot");
+        return -1;
+    }
+
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) != 0) {
+        perror("Failed to stat snapshot");
+        close(fd);
+        return -1;
+    }
+    if (stat_buf.st_size < sizeof(snapshot_header_t)) {
+        printf("Error: Malformed snapshot %s\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);    // The mapping stays valid after the descriptor is closed
+    if (map == MAP_FAILED) {
+        perror("Failed to map snapshot");
+        return -1;
+    }
+
+    // Check every section lies within the file before trusting any of it
+    const snapshot_header_t *header = map;
+    uint64_t buckets_size = (uint64_t) header->num_buckets * sizeof(uint32_t);
+    uint64_t entries_size = (uint64_t) header->num_entries * sizeof(snapshot_entry_t);
+    uint64_t expected_size =
+        sizeof(snapshot_header_t) + buckets_size + entries_size + header->names_size;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->num_buckets == 0 || (header->num_buckets & (header->num_buckets - 1)) != 0 ||
+        expected_size != stat_buf.st_size ||
+        (header->names_size > 0 && ((const char *) map)[stat_buf.st_size - 1] != '\0')) {
+        printf("Error: Malformed snapshot %s\n", path);
+        munmap(map, stat_buf.st_size);
+        return -1;
+    }
+
+    snapshot->map = map;
+    snapshot->map_size = stat_buf.st_size;
+    snapshot->num_entries = header->num_entries;
+    snapshot->num_buckets = header->num_buckets;
+    snapshot->buckets = (const uint32_t *) (header + 1);
+    snapshot->entries = (const snapshot_entry_t *) (snapshot->buckets + header->num_buckets);
+    snapshot->names = (const char *) (snapshot->entries + header->num_entries);
+    snapshot->names_size = header->names_size;
+    return 0;
+}
+
+int snapshot_lookup(const snapshot_t *snapshot, const char *file_name) {
+    if (snapshot->num_entries == 0) {
+        return -1;
+    }
+    uint32_t index = snapshot->buckets[hash_name(file_name) & (snapshot->num_buckets - 1)];
+
+    // Bounding the walk by the entry count keeps a corrupt chain from looping forever
+    for (uint32_t steps = 0; index < snapshot->num_entries && steps < snapshot->num_entries;
+         steps++) {
+        const snapshot_entry_t *entry = &snapshot->entries[index];
+        if (entry->name_offset < snapshot->names_size &&
+            strcmp(snapshot->names + entry->name_offset, file_name) == 0) {
+            return index;
+        }
+        index = entry->next;
+    }
+    return -1;
+}
+
+void snapshot_close(snapshot_t *snapshot) {
+    if (snapshot->map != NULL) {
+        munmap(snapshot->map, snapshot->map_size);
+    }
+    memset(snapshot, 0, sizeof(snapshot_t));
+}
+
+/*
+ * Writes a snapshot holding 'num_entries' entries, whose paths are in 'names',
+ * to 'path'. Entries repeating an earlier path are dropped. The snapshot is
+ * written to a temporary file and renamed into place, so an interrupted run
+ * leaves the previous snapshot intact.
+ * Returns 0 upon success, -1 upon error
+ */
+static int snapshot_write(const char *path, snapshot_entry_t *entries, uint32_t num_entries,
+                          const char *names, uint64_t names_size) {
+    snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.names_size = names_size;
+
+    // Keep chains short: at least two buckets per entry
+    header.num_buckets = 2;
+    while (header.num_buckets < 2 * (uint64_t) num_entries) {
+        header.num_buckets *= 2;
+    }
+    uint32_t *buckets = malloc(header.num_buckets * sizeof(uint32_t));
+    if (buckets == NULL) {
+        perror("Failed to allocate snapshot");
+        return -1;
+    }
+    for (uint32_t i = 0; i < header.num_buckets; i++) {
+        buckets[i] = SNAPSHOT_NO_ENTRY;
+    }
+    uint32_t num_kept = 0;
+    for (uint32_t i = 0; i < num_entries; i++) {
+        const char *name = names + entries[i].name_offset;
+        uint32_t bucket = hash_name(name) & (header.num_buckets - 1);
+        uint32_t index = buckets[bucket];
+        while (index != SNAPSHOT_NO_ENTRY &&
+               strcmp(names + entries[index].name_offset, name) != 0) {
+            index = entries[index].next;
+        }
+        if (index != SNAPSHOT_NO_ENTRY) {
+            continue;    // Same path named more than once
+        }
+        entries[num_kept] = entries[i];
+        entries[num_kept].next = buckets[bucket];
+        buckets[bucket] = num_kept++;
+    }
+    header.num_entries = num_kept;
+
+    char tmp_path[PATH_MAX];
+    if (snprintf(tmp_path, PATH_MAX, "%s.tmp", path) >= PATH_MAX) {
+        printf("Error: Snapshot path too long\n");
+        free(buckets);
+        return -1;
+    }
+    FILE *out = fopen(tmp_path, "w");
+    if (out == NULL) {
+        perror("Failed to open snapshot");
+        free(buckets);
+        return -1;
+    }
+    int ret = 0;
+    if (fwrite(&header, sizeof(header), 1, out) != 1 ||
+        fwrite(buckets, sizeof(uint32_t), header.num_buckets, out) != header.num_buckets ||
+        fwrite(entries, sizeof(snapshot_entry_t), num_kept, out) != num_kept ||
+        fwrite(names, 1, names_size, out) != names_size) {
+        perror("Failed to write snapshot");
+        ret = -1;
+    }
+    free(buckets);
+    if (fclose(out) != 0 && ret == 0) {
+        perror("Failed to close snapshot");
+        ret = -1;
+    }
+    if (ret == 0 && rename(tmp_path, path) != 0) {
+        perror("Failed to replace snapshot");
+        ret = -1;
+    }
+    if (ret != 0) {
+        unlink(tmp_path);
+    }
+    return ret;
+}
+
+// Path table of the snapshot being built, grown as paths are added
+typedef struct {
+    char *names;
+    uint64_t size;
+    uint64_t capacity;
+} name_table_t;
+
+/*
+ * Copies 'file_name' into 'table' and stores its offset in 'entry'.
+ * Returns 0 on success or -1 if an error occurs
+ */
+static int add_entry_name(name_table_t *table, snapshot_entry_t *entry, const char *file_name) {
+    size_t name_len = strlen(file_name) + 1;
+    if (table->size + name_len > table->capacity) {
+        uint64_t capacity = table->capacity * 2;
+        while (table->size + name_len > capacity) {
+            capacity *= 2;
+        }
+        char *grown = realloc(table->names, capacity);
+        if (grown == NULL) {
+            perror("Failed to allocate snapshot");
+            return -1;
+        }
+        table->names = grown;
+        table->capacity = capacity;
+    }
+    memcpy(table->names + table->size, file_name, name_len);
+    entry->name_offset = table->size;
+    table->size += name_len;
+    return 0;
+}
+
+// A file to be archived by this run, and where its state is recorded
+typedef struct {
+    uint32_t entry;    // Index of the file's entry in the new snapshot
+    int previous;      // Index of the file's entry in the previous snapshot, or -1
+} pending_t;
+
+int create_incremental_archive(const char *archive_name, const file_list_t *files,
+                               const char *snapshot_path) {
+    snapshot_t snapshot;
+    if (snapshot_load(snapshot_path, &snapshot) != 0) {
+        return -1;
+    }
+
+    // Entries of the next snapshot: every input file, plus previous entries carried over
+    uint64_t max_entries = (uint64_t) files->size + snapshot.num_entries + 1;
+    snapshot_entry_t *entries = malloc(max_entries * sizeof(snapshot_entry_t));
+    name_table_t table = {malloc(4096), 0, 4096};
+    // Which entries of the previous snapshot are still inputs
+    char *seen = calloc(snapshot.num_entries + 1, 1);
+    // One per changed file, in archive order
+    pending_t *pending = malloc((files->size + 1) * sizeof(pending_t));
+    char *written = malloc(files->size + 1);
+    // Open-addressed set of the entries recorded so far, to catch names given more than once
+    uint32_t num_slots = 2;
+    while (num_slots < 2 * (uint64_t) files->size) {
+        num_slots *= 2;
+    }
+    uint32_t *slots = malloc(num_slots * sizeof(uint32_t));
+    if (entries == NULL || table.names == NULL || seen == NULL || pending == NULL ||
+        written == NULL || slots == NULL) {
+        perror("Failed to allocate snapshot");
+        free(entries);
+        free(table.names);
+        free(seen);
+        free(pending);
+        free(written);
+        free(slots);
+        snapshot_close(&snapshot);
+        return -1;
+    }
+    for (uint32_t i = 0; i < num_slots; i++) {
+        slots[i] = SNAPSHOT_NO_ENTRY;
+    }
+
+    file_list_t changed;
+    file_list_t deleted;
+    file_list_init(&changed);
+    file_list_init(&deleted);
+    node_t *changed_tail = NULL;
+    node_t *deleted_tail = NULL;
+    uint32_t num_entries = 0;
+    int ret = 0;
+
+    for (node_t *cur = files->head; cur != NULL && ret == 0; cur = cur->next) {
+        // skip if the cur file is the archive
+        if (strcmp(cur->name, archive_name) == 0) {
+            continue;
+        }
+        uint32_t slot = hash_name(cur->name) & (num_slots - 1);
+        while (slots[slot] != SNAPSHOT_NO_ENTRY &&
+               strcmp(table.names + entries[slots[slot]].name_offset, cur->name) != 0) {
+            slot = (slot + 1) & (num_slots - 1);
+        }
+        if (slots[slot] != SNAPSHOT_NO_ENTRY) {
+            continue;    // Named more than once on the command line
+        }
+
+        struct stat stat_buf;
+        if (stat(cur->name, &stat_buf) != 0) {
+            char err_msg[MAX_MSG_LEN];
+            snprintf(err_msg, MAX_MSG_LEN, "Failed to stat file %s", cur->name);
+            perror(err_msg);
+            ret = -1;
+            break;
+        }
+        snapshot_entry_t current;
+        current.dev = stat_buf.st_dev;
+        current.ino = stat_buf.st_ino;
+        current.size = stat_buf.st_size;
+        current.mtime_ns = stat_buf.st_mtim.tv_sec * 1000000000LL + stat_buf.st_mtim.tv_nsec;
+
+        int index = snapshot_lookup(&snapshot, cur->name);
+        if (index != -1) {
+            seen[index] = 1;
+        }
+        const snapshot_entry_t *previous = (index != -1) ? &snapshot.entries[index] : NULL;
+        if (previous == NULL || previous->dev != current.dev || previous->ino != current.ino ||
+            previous->size != current.size || previous->mtime_ns != current.mtime_ns) {
+            if (file_list_append(&changed, &changed_tail, cur->name) != 0) {
+                perror("Error adding file to list");
+                ret = -1;
+                break;
+            }
+            pending[changed.size - 1].entry = num_entries;
+            pending[changed.size - 1].previous = index;
+        }
+
+        // Record the file for the next snapshot
+        if (add_entry_name(&table, &current, cur->name) != 0) {
+            ret = -1;
+            break;
+        }
+        slots[slot] = num_entries;
+        entries[num_entries++] = current;
+    }
+
+    // Inputs are listed explicitly, so a file missing from this run's list was only deleted if
+    // it is really gone. Any other file keeps its previous state.
+    for (uint32_t i = 0; i < snapshot.num_entries && ret == 0; i++) {
+        const snapshot_entry_t *entry = &snapshot.entries[i];
+        if (seen[i] || entry->name_offset >= snapshot.names_size) {
+            continue;
+        }
+        const char *name = snapshot.names + entry->name_offset;
+        struct stat stat_buf;
+        if (lstat(name, &stat_buf) != 0 && errno == ENOENT) {
+            if (file_list_append(&deleted, &deleted_tail, name) != 0) {
+                perror("Error adding file to list");
+                ret = -1;
+            }
+            continue;
+        }
+        entries[num_entries] = *entry;
+        if (add_entry_name(&table, &entries[num_entries], name) != 0) {
+            ret = -1;
+            break;
+        }
+        num_entries++;
+    }
+
+    // The snapshot only moves forward once the archive is safely written
+    if (ret == 0) {
+        ret = create_archive_with_deletions(archive_name, &changed, &deleted, written);
+    }
+    if (ret == 0) {
+        // A changed file that couldn't be archived must not be recorded as backed up: it keeps
+        // its previous state if it had one, and is left out of the snapshot otherwise, so the
+        // next run tries it again
+        for (int i = 0; i < changed.size; i++) {
+            if (written[i]) {
+                continue;
+            }
+            snapshot_entry_t *entry = &entries[pending[i].entry];
+            if (pending[i].previous == -1) {
+                entry->name_offset = SNAPSHOT_NO_ENTRY;
+                continue;
+            }
+            uint32_t name_offset = entry->name_offset;
+            *entry = snapshot.entries[pending[i].previous];
+            entry->name_offset = name_offset;
+        }
+        uint32_t num_kept = 0;
+        for (uint32_t i = 0; i < num_entries; i++) {
+            if (entries[i].name_offset != SNAPSHOT_NO_ENTRY) {
+                entries[num_kept++] = entries[i];
+            }
+        }
+        ret = snapshot_write(snapshot_path, entries, num_kept, table.names, table.size);
+    }
+
+    snapshot_close(&snapshot);
+    file_list_clear(&changed);
+    file_list_clear(&deleted);
+    free(entries);
+    free(table.names);
+    free(seen);
+    free(pending);
+    free(written);
+    free(slots);
+    return ret;
+}
@@ -0,0 +1,83 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "file_list.h"
+
+/*
+ * A snapshot records the state of every file archived by a listed-incremental
+ * run, so the next run can tell which files are new, changed or deleted.
+ *
+ * On-disk layout, in native byte order (snapshots aren't meant to move between
+ * machines), designed to be used in place through mmap:
+ *   snapshot_header_t
+ *   uint32_t buckets[num_buckets]         (first entry of each hash chain)
+ *   snapshot_entry_t entries[num_entries]
+ *   char names[names_size]                (null-terminated paths)
+ */
+
+#define SNAPSHOT_MAGIC "MTSNAP01"
+// Marks the end of a hash chain
+#define SNAPSHOT_NO_ENTRY UINT32_MAX
+
+typedef struct {
+    char magic[8];
+    uint32_t num_entries;
+    uint32_t num_buckets;    // Always a power of two
+    uint64_t names_size;
+} snapshot_header_t;
+
+// State of one file as of the previous run
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_ns;    // Modification time in nanoseconds since the Unix epoch
+    uint32_t name_offset;    // Offset of the file's path in the name table
+    uint32_t next;           // Next entry in the same hash chain
+} snapshot_entry_t;
+
+// A loaded snapshot, mapped read-only
+typedef struct {
+    void *map;
+    size_t map_size;
+    uint32_t num_entries;
+    uint32_t num_buckets;
+    const uint32_t *buckets;
+    const snapshot_entry_t *entries;
+    const char *names;
+    uint64_t names_size;
+} snapshot_t;
+
+/*
+ * Map the snapshot file 'path' into 'snapshot'. A missing file loads as an
+ * empty snapshot, which makes the first run a full backup.
+ * Returns 0 on success or -1 if the file can't be read or is malformed.
+ */
+int snapshot_load(const char *path, snapshot_t *snapshot);
+
+/*
+ * Find the entry for 'file_name' in 'snapshot'.
+ * Returns the entry's index, or -1 if the snapshot has no such entry.
+ */
+int snapshot_lookup(const snapshot_t *snapshot, const char *file_name);
+
+// Unmap 'snapshot'
+void snapshot_close(snapshot_t *snapshot);
+
+/*
+ * Create a listed-incremental archive named 'archive_name'. Each file in
+ * 'files' is compared against the snapshot stored at 'snapshot_path', and only
+ * files that are new or whose device, inode, size or modification time changed
+ * are archived. Files recorded in the snapshot but no longer in 'files' are
+ * archived as deletion markers if they no longer exist, and otherwise keep
+ * their recorded state. On success, the snapshot is replaced with the current
+ * state of every file that was archived or left unchanged; a file that couldn't
+ * be read is left as it was, so the next run tries it again.
+ * This function should return 0 upon success or -1 if an error occurred.
+ */
+int create_incremental_archive(const char *archive_name, const file_list_t *files,
+                               const char *snapshot_path);
+
+#endif    // _SNAPSHOT_H
@@ -0,0 +1,393 @@
+#include "volumes.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "minitar.h"
+
+#define MAX_MSG_LEN 128
+#define MANIFEST_MAGIC "MINITAR-VOLUMES"
+
+// State for a single volume, handed to the thread that writes or reads it
+typedef struct {
+    char path[PATH_MAX];    // Where the volume lives on disk
+    file_list_t files;      // Members written to (create) or read from (list) this volume
+    long long bytes;        // Total size of the member file contents
+    int result;             // Return value of the per-volume operation
+} volume_t;
+
+// A member file to be placed in a volume, along with its position in the input list
+typedef struct {
+    const char *name;
+    long long size;
+    int index;
+} member_t;
+
+/*
+ * Orders members largest first, so the greedy placement below gives a good
+ * balance. Ties are broken by name so that repeated names end up adjacent,
+ * then by input position to keep the placement deterministic.
+ */
+static int compare_members(const void *a, const void *b) {
+    const member_t *m1 = a;
+    const member_t *m2 = b;
+    if (m1->size != m2->size) {
+        return m1->size < m2->size ? 1 : -1;
+    }
+    int cmp = strcmp(m1->name, m2->name);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return m1->index - m2->index;
+}
+
+/*
+ * Fills in the on-disk path of each volume described by 'volume_spec' (see
+ * create_volume_archive in volumes.h).
+ * Returns the number of volumes on success or -1 if the spec is invalid
+ */
+static int parse_volume_spec(const char *archive_name, const char *volume_spec,
+                             volume_t *volumes) {
+    const char *base_name = strrchr(archive_name, '/');
+    base_name = (base_name == NULL) ? archive_name : base_name + 1;
+
+    // A plain number means "this many volumes, next to the manifest"
+    if (volume_spec[0] != '\0' && strspn(volume_spec, "0123456789") == strlen(volume_spec)) {
+        int num_volumes = atoi(volume_spec);
+        if (num_volumes < 1 || num_volumes > MAX_VOLUMES) {
+            printf("Error: Volume count must be between 1 and %d\n", MAX_VOLUMES);
+            return -1;
+        }
+        for (int i = 0; i < num_volumes; i++) {
+            snprintf(volumes[i].path, PATH_MAX, "%s.%d", archive_name, i);
+        }
+        return num_volumes;
+    }
+
+    // Otherwise, one volume per directory (typically one per mount point)
+    char *spec_copy = strdup(volume_spec);
+    if (spec_copy == NULL) {
+        perror("Failed to parse volume list");
+        return -1;
+    }
+    int num_volumes = 0;
+    char *save_ptr;
+    for (char *dir = strtok_r(spec_copy, ",", &save_ptr); dir != NULL;
+         dir = strtok_r(NULL, ",", &save_ptr)) {
+        if (num_volumes == MAX_VOLUMES) {
+            printf("Error: At most %d volumes are supported\n", MAX_VOLUMES);
+            free(spec_copy);
+            return -1;
+        }
+        // Store absolute paths so the manifest stays valid from any directory
+        char dir_path[PATH_MAX];
+        if (realpath(dir, dir_path) == NULL) {
+            char err_msg[MAX_MSG_LEN];
+            snprintf(err_msg, MAX_MSG_LEN, "Failed to resolve volume directory %s", dir);
+            perror(err_msg);
+            free(spec_copy);
+            return -1;
+        }
+        if (snprintf(volumes[num_volumes].path, PATH_MAX, "%s/%s.%d", dir_path, base_name,
+                     num_volumes) >= PATH_MAX) {
+            printf("Error: Volume path too long\n");
+            free(spec_copy);
+            return -1;
+        }
+        num_volumes++;
+    }
+    free(spec_copy);
+
+    if (num_volumes == 0) {
+        printf("Error: No volumes specified\n");
+        return -1;
+    }
+    return num_volumes;
+}
+
+/*
+ * Reads the manifest of the sharded archive 'archive_name', allocating and
+ * filling in '*volumes' with one entry per volume.
+ * Returns the number of volumes on success or -1 if an error occurs
+ */
+static int read_manifest(const char *archive_name, volume_t **volumes) {
+    FILE *manifest = fopen(archive_name, "r");
+    if (manifest == NULL) {
+        perror("Error opening archive");
+        return -1;
+    }
+
+    int num_volumes = 0;
+    char magic[sizeof(MANIFEST_MAGIC)];
+    if (fscanf(manifest, "%15s %d\n", magic, &num_volumes) != 2 ||
+        strcmp(magic, MANIFEST_MAGIC) != 0 || num_volumes < 1 || num_volumes > MAX_VOLUMES) {
+        printf("Error: Malformed volume manifest %s\n", archive_name);
+        fclose(manifest);
+        return -1;
+    }
+
+    *volumes = calloc(num_volumes, sizeof(volume_t));
+    if (*volumes == NULL) {
+        perror("Failed to allocate volume table");
+        fclose(manifest);
+        return -1;
+    }
+
+    // Relative volume paths are relative to the directory holding the manifest
+    const char *slash = strrchr(archive_name, '/');
+    int dir_len = (slash == NULL) ? 0 : (int) (slash - archive_name) + 1;
+
+    char line[PATH_MAX + 64];
+    for (int i = 0; i < num_volumes; i++) {
+        int members;
+        int path_start = 0;
+        if (fgets(line, sizeof(line), manifest) == NULL ||
+            sscanf(line, "%d %lld %n", &members, &(*volumes)[i].bytes, &path_start) != 2 ||
+            path_start == 0) {
+            printf("Error: Malformed volume manifest %s\n", archive_name);
+            free(*volumes);
+            fclose(manifest);
+            return -1;
+        }
+        char *path = line + path_start;
+        path[strcspn(path, "\n")] = '\0';
+
+        int len;
+        if (path[0] == '/') {
+            len = snprintf((*volumes)[i].path, PATH_MAX, "%s", path);
+        } else {
+            len = snprintf((*volumes)[i].path, PATH_MAX, "%.*s%s", dir_len, archive_name, path);
+        }
+        if (len >= PATH_MAX) {
+            printf("Error: Volume path too long\n");
+            free(*volumes);
+            fclose(manifest);
+            return -1;
+        }
+        file_list_init(&(*volumes)[i].files);
+    }
+
+    fclose(manifest);
+    return num_volumes;
+}
+
+/*
+ * Runs 'worker' once per volume, each in its own thread, and waits for all of
+ * them to finish. If a thread can't be started, that volume is handled in the
+ * calling thread instead.
+ * Returns 0 if every volume's 'result' is 0, -1 otherwise
+ */
+static int run_volume_workers(volume_t *volumes, int num_volumes, void *(*worker)(void *)) {
+    pthread_t threads[MAX_VOLUMES];
+    int started[MAX_VOLUMES];
+
+    for (int i = 0; i < num_volumes; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, worker, &volumes[i]) == 0);
+        if (!started[i]) {
+            worker(&volumes[i]);
+        }
+    }
+
+    int ret = 0;
+    for (int i = 0; i < num_volumes; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+        if (volumes[i].result != 0) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+static void *create_volume_worker(void *arg) {
+    volume_t *volume = arg;
+    volume->result = create_archive(volume->path, &volume->files);
+    return NULL;
+}
+
+static void *list_volume_worker(void *arg) {
+    volume_t *volume = arg;
+    volume->result = get_archive_file_list(volume->path, &volume->files);
+    return NULL;
+}
+
+static void *extract_volume_worker(void *arg) {
+    volume_t *volume = arg;
+    volume->result = extract_files_from_archive(volume->path);
+    return NULL;
+}
+
+int is_volume_manifest(const char *archive_name) {
+    FILE *archive = fopen(archive_name, "r");
+    if (archive == NULL) {
+        return 0;
+    }
+    char magic[sizeof(MANIFEST_MAGIC) - 1];
+    size_t bytes_read = fread(magic, 1, sizeof(magic), archive);
+    fclose(archive);
+    return bytes_read == sizeof(magic) && memcmp(magic, MANIFEST_MAGIC, sizeof(magic)) == 0;
+}
+
+int create_volume_archive(const char *archive_name, const file_list_t *files,
+                          const char *volume_spec) {
+    volume_t *volumes = calloc(MAX_VOLUMES, sizeof(volume_t));
+    if (volumes == NULL) {
+        perror("Failed to allocate volume table");
+        return -1;
+    }
+    int num_volumes = parse_volume_spec(archive_name, volume_spec, volumes);
+    if (num_volumes == -1) {
+        free(volumes);
+        return -1;
+    }
+    for (int i = 0; i < num_volumes; i++) {
+        file_list_init(&volumes[i].files);
+    }
+
+    member_t *members = malloc(files->size * sizeof(member_t));
+    int *placement = malloc(files->size * sizeof(int));
+    if ((members == NULL || placement == NULL) && files->size > 0) {
+        perror("Failed to allocate member table");
+        free(members);
+        free(placement);
+        free(volumes);
+        return -1;
+    }
+
+    // Gather member sizes; the manifest itself is never archived
+    int num_members = 0;
+    int index = 0;
+    for (node_t *cur = files->head; cur != NULL; cur = cur->next, index++) {
+        placement[index] = -1;
+        if (strcmp(cur->name, archive_name) == 0) {
+            continue;
+        }
+        struct stat stat_buf;
+        if (stat(cur->name, &stat_buf) != 0) {
+            char err_msg[MAX_MSG_LEN];
+            snprintf(err_msg, MAX_MSG_LEN, "Failed to stat file %s", cur->name);
+            perror(err_msg);
+            free(members);
+            free(placement);
+            free(volumes);
+            return -1;
+        }
+        members[num_members].name = cur->name;
+        members[num_members].size = stat_buf.st_size;
+        members[num_members].index = index;
+        num_members++;
+    }
+
+    // Greedy balancing: each member goes to the currently lightest volume.
+    // Repeated names share a volume so parallel extraction never races on a file.
+    qsort(members, num_members, sizeof(member_t), compare_members);
+    for (int i = 0; i < num_members; i++) {
+        int target = 0;
+        if (i > 0 && strcmp(members[i].name, members[i - 1].name) == 0) {
+            target = placement[members[i - 1].index];
+        } else {
+            for (int v = 1; v < num_volumes; v++) {
+                if (volumes[v].bytes < volumes[target].bytes) {
+                    target = v;
+                }
+            }
+        }
+        placement[members[i].index] = target;
+        volumes[target].bytes += members[i].size;
+    }
+    free(members);
+
+    // Within each volume, members keep their command-line order
+    int ret = 0;
+    index = 0;
+    for (node_t *cur = files->head; cur != NULL; cur = cur->next, index++) {
+        if (placement[index] == -1) {
+            continue;
+        }
+        if (file_list_add(&volumes[placement[index]].files, cur->name) != 0) {
+            perror("Error adding file to volume");
+            ret = -1;
+            break;
+        }
+    }
+    free(placement);
+
+    if (ret == 0) {
+        ret = run_volume_workers(volumes, num_volumes, create_volume_worker);
+    }
+
+    // The manifest is only written once every volume is complete
+    if (ret == 0) {
+        FILE *manifest = fopen(archive_name, "w");
+        if (manifest == NULL) {
+            perror("Failed to open archive");
+            ret = -1;
+        } else {
+            fprintf(manifest, "%s %d\n", MANIFEST_MAGIC, num_volumes);
+            for (int i = 0; i < num_volumes; i++) {
+                // Volumes stored next to the manifest are recorded by base name only
+                const char *path = volumes[i].path;
+                if (path[0] != '/' && strrchr(path, '/') != NULL) {
+                    path = strrchr(path, '/') + 1;
+                }
+                fprintf(manifest, "%d %lld %s\n", volumes[i].files.size, volumes[i].bytes, path);
+            }
+            if (fclose(manifest) != 0) {
+                perror("Failed to close archive file");
+                ret = -1;
+            }
+        }
+    }
+
+    for (int i = 0; i < num_volumes; i++) {
+        file_list_clear(&volumes[i].files);
+    }
+    free(volumes);
+    return ret;
+}
+
+int get_volume_archive_file_list(const char *archive_name, file_list_t *files) {
+    volume_t *volumes;
+    int num_volumes = read_manifest(archive_name, &volumes);
+    if (num_volumes == -1) {
+        return -1;
+    }
+
+    file_list_init(files);
+    int ret = run_volume_workers(volumes, num_volumes, list_volume_worker);
+
+    for (int i = 0; i < num_volumes; i++) {
+        node_t *cur = volumes[i].files.head;
+        while (ret == 0 && cur != NULL) {
+            if (file_list_add(files, cur->name) != 0) {
+                perror("Error adding file to list");
+                ret = -1;
+            }
+            cur = cur->next;
+        }
+        file_list_clear(&volumes[i].files);
+    }
+    free(volumes);
+
+    if (ret != 0) {
+        file_list_clear(files);
+    }
+    return ret;
+}
+
+int extract_files_from_volume_archive(const char *archive_name) {
+    volume_t *volumes;
+    int num_volumes = read_manifest(archive_name, &volumes);
+    if (num_volumes == -1) {
+        return -1;
+    }
+
+    int ret = run_volume_workers(volumes, num_volumes, extract_volume_worker);
+    free(volumes);
+    return ret;
+}
@@ -0,0 +1,53 @@
+#ifndef _VOLUMES_H
+#define _VOLUMES_H
+#include "file_list.h"
+
+// Upper bound on the number of volumes a sharded archive may be split into
+#define MAX_VOLUMES 64
+
+/*
+ * A sharded (multi-volume) archive is a small text manifest stored under the
+ * archive's name, followed by N ordinary tar volumes. Each volume holds a
+ * disjoint subset of the members, so volumes can be written and read in
+ * parallel, one thread per volume.
+ *
+ * Manifest layout:
+ *   MINITAR-VOLUMES <N>
+ *   <members> <bytes> <volume path>     (one line per volume)
+ * Relative volume paths are resolved against the manifest's directory.
+ */
+
+/*
+ * Returns 1 if 'archive_name' names a sharded archive manifest, 0 otherwise
+ * (including when the file can't be read).
+ */
+int is_volume_manifest(const char *archive_name);
+
+/*
+ * Create a sharded archive named 'archive_name' from the files in 'files'.
+ * 'volume_spec' is either a volume count ("4"), in which case the volumes are
+ * stored next to the manifest as '<archive_name>.<i>', or a comma-separated list
+ * of directories ("/mnt/a,/mnt/b"), in which case one volume is stored in each.
+ * Members are balanced across volumes by byte size and each volume is written
+ * by its own thread.
+ * This function should return 0 upon success or -1 if an error occurred.
+ */
+int create_volume_archive(const char *archive_name, const file_list_t *files,
+                          const char *volume_spec);
+
+/*
+ * Add the name of each file contained in any volume of the sharded archive
+ * 'archive_name' to the 'files' list, reading all volumes concurrently.
+ * Names are listed volume by volume.
+ * This function should return 0 upon success or -1 if an error occurred.
+ */
+int get_volume_archive_file_list(const char *archive_name, file_list_t *files);
+
+/*
+ * Extract every volume of the sharded archive 'archive_name' into the current
+ * working directory, one thread per volume.
+ * This function should return 0 upon success or -1 if an error occurred.
+ */
+int extract_files_from_volume_archive(const char *archive_name);
+
+#endif    // _VOLUMES_H